@@ -0,0 +1,231 @@
+#include "autotune.h"
+#include "correlated_spikes.h"
+#include "ensemble.h"
+#include "synapse.h"
+#include "thread_pool.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bump when a tuned kernel changes enough that cached choices may be stale
+const int kTunerVersion = 1;
+// A costlier setting must beat the cheaper one by this fraction to be chosen
+const double kMargin = 0.05;
+
+const char* kHeader = "cpu,hardware_threads,version,threads,lanes,spike_grain,csv_buffer";
+
+unsigned hardware_threads() {
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads > 0 ? threads : 1;
+}
+
+// Fastest of a few repetitions, which filters out scheduling hiccups
+template <typename Fn>
+double best_seconds(int repetitions, Fn fn) {
+    double best = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// Index of the candidate to use: candidates are ordered cheapest first, and a
+// later one wins only if it beats the current choice by the margin
+size_t pick(const std::vector<double>& seconds) {
+    size_t chosen = 0;
+    for (size_t i = 1; i < seconds.size(); ++i) {
+        if (seconds[i] < seconds[chosen] * (1 - kMargin)) chosen = i;
+    }
+    return chosen;
+}
+
+EnsembleConfig benchmark_ensemble(size_t replicas, int lanes) {
+    EnsembleConfig ens;
+    ens.sim_duration = 10.0;
+    ens.dt = 0.01;
+    ens.learning_rate = 0.5;
+    ens.decay_rate = 0.1;
+    ens.initial_weight = 0.5;
+    ens.replicas = replicas;
+    ens.seed = 1;
+    ens.lanes = lanes;
+    return ens;
+}
+
+// Lane blocks of one ensemble spread over `pool`, as the Sobol and calibration modes run them
+void run_parallel(const Ensemble& ensemble, ThreadPool& pool) {
+    const size_t lanes = static_cast<size_t>(ensemble.get_config().lanes);
+    const size_t blocks = (ensemble.get_config().replicas + lanes - 1) / lanes;
+    std::vector<FinalStateRecorder> recorders(pool.size());
+    pool.parallel_for(blocks, 1, [&](size_t begin, size_t end, size_t worker) {
+        ensemble.run_replicas(begin * lanes, (end - begin) * lanes, recorders[worker]);
+    });
+}
+
+std::vector<std::string> split_fields(const std::string& line) {
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ',')) fields.push_back(field);
+    return fields;
+}
+
+std::string cache_row_key() {
+    return cpu_model() + "," + std::to_string(hardware_threads()) + "," + std::to_string(kTunerVersion);
+}
+
+} // namespace
+
+std::string cpu_model() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") != 0) continue;
+        std::string::size_type colon = line.find(':');
+        if (colon == std::string::npos) break;
+        std::string model;
+        for (char c : line.substr(colon + 1)) {
+            if (c != ',' && !(model.empty() && c == ' ')) model += c;
+        }
+        if (!model.empty()) return model;
+    }
+    return "unknown";
+}
+
+TunedParameters tune_parameters() {
+    TunedParameters tuned;
+
+    // Hebbian update: the 4-, 8- and 16-lane kernels on one thread
+    const int lane_options[] = {8, 4, 16};
+    std::vector<double> seconds;
+    for (int lanes : lane_options) {
+        Ensemble ensemble(benchmark_ensemble(512, lanes));
+        FinalStateRecorder recorder;
+        seconds.push_back(best_seconds(3, [&]() { ensemble.run(recorder); }));
+    }
+    tuned.lanes = lane_options[pick(seconds)];
+
+    // Thread count: powers of two up to every hardware thread, with that kernel
+    std::vector<size_t> thread_options;
+    for (size_t threads = 1; threads < hardware_threads(); threads *= 2) thread_options.push_back(threads);
+    thread_options.push_back(hardware_threads());
+    seconds.clear();
+    Ensemble ensemble(benchmark_ensemble(2048, tuned.lanes));
+    for (size_t threads : thread_options) {
+        ThreadPool pool(threads);
+        seconds.push_back(best_seconds(3, [&]() { run_parallel(ensemble, pool); }));
+    }
+    tuned.threads = thread_options[pick(seconds)];
+
+    // RNG fill: task size of the correlated raster, on the chosen pool
+    const size_t grain_options[] = {65536, 16384, 262144, 1048576};
+    seconds.clear();
+    {
+        ThreadPool pool(tuned.threads);
+        CorrelatedSpikeGenerator generator(std::vector<double>(256, 20.0), std::vector<double>(256, 0.1), 0.001, 1);
+        FirstTouchVector<uint8_t> raster;
+        for (size_t grain : grain_options) {
+            seconds.push_back(best_seconds(2, [&]() { generator.fill(0, 8192, raster, &pool, grain); }));
+        }
+    }
+    tuned.spike_grain = grain_options[pick(seconds)];
+
+    // Output formatting: CSV rows through stream buffers of each size
+    SimRows rows(50000);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i] = {i * 0.01, static_cast<double>(i % 3 == 0), static_cast<double>(i % 5 == 0), 0.5 + i * 1e-6, "autotune"};
+    }
+    const std::string scratch = (fs::temp_directory_path() / ("qd_autotune_" + std::to_string(::getpid()) + ".csv")).string();
+    const size_t buffer_options[] = {0, 65536, 1048576};
+    seconds.clear();
+    for (size_t buffer : buffer_options) {
+        seconds.push_back(best_seconds(2, [&]() { write_results(scratch, rows, buffer); }));
+    }
+    std::error_code error;
+    fs::remove(scratch, error);
+    tuned.csv_buffer = buffer_options[pick(seconds)];
+    return tuned;
+}
+
+bool load_tuned_parameters(const std::string& filepath, TunedParameters& tuned) {
+    std::ifstream infile(filepath);
+    if (!infile.is_open()) return false;
+    const std::string key = cache_row_key();
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (line.compare(0, key.size() + 1, key + ",") != 0) continue;
+        std::vector<std::string> fields = split_fields(line);
+        if (fields.size() != 7) continue;
+        try {
+            tuned.threads = std::stoul(fields[3]);
+            tuned.lanes = std::stoi(fields[4]);
+            tuned.spike_grain = std::stoul(fields[5]);
+            tuned.csv_buffer = std::stoul(fields[6]);
+        } catch (const std::exception&) {
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool save_tuned_parameters(const std::string& filepath, const TunedParameters& tuned) {
+    // Keep the rows of other machines sharing this file
+    const std::string key = cache_row_key();
+    std::vector<std::string> rows;
+    {
+        std::ifstream infile(filepath);
+        std::string line;
+        while (std::getline(infile, line)) {
+            if (!line.empty() && line != kHeader && line.compare(0, key.size() + 1, key + ",") != 0) rows.push_back(line);
+        }
+    }
+    rows.push_back(key + "," + std::to_string(tuned.threads) + "," + std::to_string(tuned.lanes) + "," +
+                   std::to_string(tuned.spike_grain) + "," + std::to_string(tuned.csv_buffer));
+
+    // Written aside and renamed, so runs starting concurrently never read half a file
+    const std::string staging = filepath + "." + std::to_string(::getpid()) + ".partial";
+    std::ofstream outfile(staging);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << staging << std::endl;
+        return false;
+    }
+    outfile << kHeader << "\n";
+    for (const auto& row : rows) outfile << row << "\n";
+    outfile.close();
+    std::error_code error;
+    fs::rename(staging, filepath, error);
+    if (error) {
+        std::cerr << "Error: Could not write " << filepath << ": " << error.message() << std::endl;
+        fs::remove(staging, error);
+        return false;
+    }
+    return true;
+}
+
+TunedParameters load_or_tune(const std::string& filepath, bool retune) {
+    TunedParameters tuned;
+    if (!retune && load_tuned_parameters(filepath, tuned)) return tuned;
+
+    std::cout << "Auto-tuning kernels for " << cpu_model() << " (" << hardware_threads() << " threads)..." << std::endl;
+    tuned = tune_parameters();
+    std::cout << "Tuned: " << tuned.threads << " threads, " << tuned.lanes << " ensemble lanes, "
+              << tuned.spike_grain << " channel-steps per spike task, "
+              << (tuned.csv_buffer ? std::to_string(tuned.csv_buffer) + " byte" : std::string("default")) << " CSV buffer"
+              << std::endl;
+    // A failed save only means tuning runs again next time
+    if (save_tuned_parameters(filepath, tuned)) std::cout << "Tuning saved to " << filepath << std::endl;
+    return tuned;
+}
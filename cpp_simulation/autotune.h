@@ -0,0 +1,34 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <cstddef>
+#include <string>
+
+// Kernel parameters whose best value depends on the machine. The defaults are
+// what every run used before tuning existed.
+struct TunedParameters {
+    size_t threads = 0;          // worker threads for the parallel modes (0: one per hardware thread)
+    int lanes = 8;               // ensemble replicas stepped together: selects the 4-, 8- or 16-wide kernel
+    size_t spike_grain = 65536;  // channel-steps per task when filling correlated spike rasters
+    size_t csv_buffer = 0;       // stream buffer bytes for trajectory CSVs (0: library default)
+};
+
+// "model name" of the first CPU in /proc/cpuinfo (commas removed), or "unknown"
+std::string cpu_model();
+
+// Micro-benchmarks the Hebbian ensemble kernel, the spike-raster fill and CSV
+// formatting with each candidate setting and keeps the fastest (about a second).
+// A setting only replaces a cheaper one (fewer threads, default buffer) when it
+// is clearly faster, so timer noise does not flip choices between runs.
+TunedParameters tune_parameters();
+
+// The cache holds one row per CPU model and hardware thread count, so a data
+// directory shared between node types keeps a separate choice for each.
+bool load_tuned_parameters(const std::string& filepath, TunedParameters& tuned);
+bool save_tuned_parameters(const std::string& filepath, const TunedParameters& tuned);
+
+// Cached parameters for this machine, tuning and caching them on the first run
+// (or whenever `retune` is set)
+TunedParameters load_or_tune(const std::string& filepath, bool retune = false);
+
+#endif // AUTOTUNE_H
@@ -0,0 +1,270 @@
+#include "calibration.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+namespace {
+
+typedef std::vector<std::vector<double>> Matrix;
+
+// Cyclic Jacobi eigendecomposition of a small symmetric matrix: a = v * diag(values) * v^T
+void symmetric_eigen(Matrix a, Matrix& v, std::vector<double>& values) {
+    const size_t n = a.size();
+    v.assign(n, std::vector<double>(n, 0.0));
+    for (size_t i = 0; i < n; ++i) v[i][i] = 1.0;
+
+    for (int sweep = 0; sweep < 50; ++sweep) {
+        double off = 0;
+        for (size_t p = 0; p < n; ++p)
+            for (size_t q = p + 1; q < n; ++q) off += a[p][q] * a[p][q];
+        if (off < 1e-30) break;
+
+        for (size_t p = 0; p < n; ++p) {
+            for (size_t q = p + 1; q < n; ++q) {
+                if (std::fabs(a[p][q]) < 1e-300) continue;
+                double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+                double c = 1 / std::sqrt(t * t + 1);
+                double s = t * c;
+                for (size_t k = 0; k < n; ++k) {
+                    double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    double vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    values.resize(n);
+    for (size_t i = 0; i < n; ++i) values[i] = a[i][i];
+}
+
+// Standard normal draw from the counter-based stream (Box-Muller)
+double normal(uint64_t key, uint64_t counter) {
+    double u1 = CounterRng::uniform(key, 2 * counter);
+    double u2 = CounterRng::uniform(key, 2 * counter + 1);
+    return std::sqrt(-2.0 * std::log(1.0 - u1)) * std::cos(2.0 * M_PI * u2);
+}
+
+// Points are memoized on a 1e-6 grid of the unit box
+const double kGridResolution = 1e6;
+
+} // namespace
+
+// --- Calibrator Class Implementation ---
+
+Calibrator::Calibrator(const CalibrationConfig& config, ThreadPool& pool) : config(config), pool(pool) {}
+
+std::vector<double> Calibrator::to_params(const std::vector<double>& unit_point) const {
+    std::vector<double> params(unit_point.size());
+    for (size_t i = 0; i < unit_point.size(); ++i) {
+        const ParameterRange& range = config.ranges[i];
+        params[i] = range.low + unit_point[i] * (range.high - range.low);
+    }
+    return params;
+}
+
+Calibrator::GridKey Calibrator::snap(std::vector<double>& unit_point) const {
+    GridKey key(unit_point.size());
+    for (size_t i = 0; i < unit_point.size(); ++i) {
+        double x = std::min(1.0, std::max(0.0, unit_point[i]));
+        key[i] = std::llround(x * kGridResolution);
+        unit_point[i] = key[i] / kGridResolution;
+    }
+    return key;
+}
+
+Calibrator::Evaluation Calibrator::evaluate(const std::vector<double>& unit_point) const {
+    EnsembleConfig run = config.base;
+    std::vector<double> params = to_params(unit_point);
+    for (size_t i = 0; i < params.size(); ++i) {
+        set_parameter(run, config.ranges[i].name, params[i]);
+    }
+    FinalWeightSummary summary = summarize_final_weight(run);
+
+    Evaluation evaluation;
+    evaluation.mean = summary.mean;
+    evaluation.std_dev = std::sqrt(summary.variance);
+    double error = evaluation.mean - config.target.mean_final_weight;
+    evaluation.loss = error * error;
+    if (config.target.std_final_weight >= 0) {
+        double std_error = evaluation.std_dev - config.target.std_final_weight;
+        evaluation.loss += std_error * std_error;
+    }
+    return evaluation;
+}
+
+CalibrationResult Calibrator::run() {
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    // --- Strategy parameters (Hansen, "The CMA Evolution Strategy: A Tutorial") ---
+    const size_t n = config.ranges.size();
+    const double dn = static_cast<double>(n);
+    const size_t lambda = config.population ? config.population : 4 + static_cast<size_t>(3 * std::log(dn));
+    const size_t mu = lambda / 2;
+    std::vector<double> weights(mu);
+    for (size_t i = 0; i < mu; ++i) weights[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+    double weight_sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+    double weight_sq = 0;
+    for (double& w : weights) {
+        w /= weight_sum;
+        weight_sq += w * w;
+    }
+    const double mueff = 1.0 / weight_sq;
+    const double cc = (4 + mueff / dn) / (dn + 4 + 2 * mueff / dn);
+    const double cs = (mueff + 2) / (dn + mueff + 5);
+    const double c1 = 2 / ((dn + 1.3) * (dn + 1.3) + mueff);
+    const double cmu = std::min(1 - c1, 2 * (mueff - 2 + 1 / mueff) / ((dn + 2) * (dn + 2) + mueff));
+    const double damps = 1 + 2 * std::max(0.0, std::sqrt((mueff - 1) / (dn + 1)) - 1) + cs;
+    const double chi_n = std::sqrt(dn) * (1 - 1 / (4 * dn) + 1 / (21 * dn * dn));
+
+    // --- State ---
+    std::vector<double> mean(n, 0.5), pc(n, 0.0), ps(n, 0.0), eigen_d(n, 1.0);
+    Matrix cov(n, std::vector<double>(n, 0.0)), basis(n, std::vector<double>(n, 0.0));
+    for (size_t i = 0; i < n; ++i) cov[i][i] = basis[i][i] = 1.0;
+    double sigma = config.initial_sigma;
+    const uint64_t key = CounterRng::replica_key(config.base.seed, 0xCA11B8u);
+    uint64_t draws = 0;
+
+    CalibrationResult result;
+    result.best_loss = INFINITY;
+    result.best_mean = result.best_std = 0;
+    result.evaluations = result.cache_hits = result.generations = 0;
+    const size_t budget = config.max_runs / (config.base.replicas ? config.base.replicas : 1);
+
+    while (result.evaluations < budget && (config.max_seconds <= 0 || elapsed() < config.max_seconds)) {
+        // Sample lambda candidates x = m + sigma * B * D * z
+        std::vector<std::vector<double>> y(lambda, std::vector<double>(n)), x(lambda, std::vector<double>(n));
+        std::vector<GridKey> keys(lambda);
+        for (size_t k = 0; k < lambda; ++k) {
+            std::vector<double> z(n);
+            for (size_t i = 0; i < n; ++i) z[i] = eigen_d[i] * normal(key, draws++);
+            for (size_t i = 0; i < n; ++i) {
+                double yi = 0;
+                for (size_t j = 0; j < n; ++j) yi += basis[i][j] * z[j];
+                y[k][i] = yi;
+                x[k][i] = mean[i] + sigma * yi;
+            }
+        }
+
+        // Snap to the grid, answer what the cache knows and evaluate the rest in parallel
+        std::vector<double> penalty(lambda, 0.0);
+        std::vector<std::vector<double>> points = x;
+        std::vector<size_t> pending;
+        std::vector<Evaluation> evaluations(lambda);
+        for (size_t k = 0; k < lambda; ++k) {
+            for (size_t i = 0; i < n; ++i) {
+                double outside = x[k][i] < 0 ? -x[k][i] : (x[k][i] > 1 ? x[k][i] - 1 : 0.0);
+                penalty[k] += outside * outside;
+            }
+            keys[k] = snap(points[k]);
+            bool seen = cache.count(keys[k]) || std::find(keys.begin(), keys.begin() + k, keys[k]) != keys.begin() + k;
+            if (seen) {
+                ++result.cache_hits;
+            } else {
+                pending.push_back(k);
+            }
+        }
+        pool.parallel_for(pending.size(), 1, [&](size_t begin, size_t end, size_t) {
+            for (size_t p = begin; p < end; ++p) evaluations[pending[p]] = evaluate(points[pending[p]]);
+        });
+        for (size_t k : pending) cache[keys[k]] = evaluations[k];
+        for (size_t k = 0; k < lambda; ++k) evaluations[k] = cache[keys[k]];
+        result.evaluations += pending.size();
+        ++result.generations;
+
+        std::vector<size_t> order(lambda);
+        std::iota(order.begin(), order.end(), 0);
+        std::vector<double> fitness(lambda);
+        for (size_t k = 0; k < lambda; ++k) fitness[k] = evaluations[k].loss + penalty[k];
+        std::sort(order.begin(), order.end(), [&fitness](size_t a, size_t b) { return fitness[a] < fitness[b]; });
+
+        const Evaluation& best = evaluations[order[0]];
+        if (best.loss < result.best_loss) {
+            result.best_loss = best.loss;
+            result.best_mean = best.mean;
+            result.best_std = best.std_dev;
+            result.best_params = to_params(points[order[0]]);
+        }
+
+        // --- Update mean, evolution paths, covariance and step size ---
+        std::vector<double> y_w(n, 0.0);
+        for (size_t r = 0; r < mu; ++r)
+            for (size_t i = 0; i < n; ++i) y_w[i] += weights[r] * y[order[r]][i];
+        for (size_t i = 0; i < n; ++i) mean[i] += sigma * y_w[i];
+
+        // C^(-1/2) * y_w = B * D^-1 * B^T * y_w
+        std::vector<double> bt_y(n, 0.0), inv_sqrt_y(n, 0.0);
+        for (size_t j = 0; j < n; ++j)
+            for (size_t i = 0; i < n; ++i) bt_y[j] += basis[i][j] * y_w[i];
+        for (size_t j = 0; j < n; ++j) bt_y[j] /= eigen_d[j];
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = 0; j < n; ++j) inv_sqrt_y[i] += basis[i][j] * bt_y[j];
+
+        double ps_norm = 0;
+        for (size_t i = 0; i < n; ++i) {
+            ps[i] = (1 - cs) * ps[i] + std::sqrt(cs * (2 - cs) * mueff) * inv_sqrt_y[i];
+            ps_norm += ps[i] * ps[i];
+        }
+        ps_norm = std::sqrt(ps_norm);
+        double generation_factor = 1 - std::pow(1 - cs, 2.0 * result.generations);
+        bool hsig = ps_norm / std::sqrt(generation_factor) / chi_n < 1.4 + 2 / (dn + 1);
+        for (size_t i = 0; i < n; ++i) {
+            pc[i] = (1 - cc) * pc[i] + (hsig ? std::sqrt(cc * (2 - cc) * mueff) : 0.0) * y_w[i];
+        }
+
+        double rank_one_correction = hsig ? 0.0 : cc * (2 - cc);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                double rank_mu = 0;
+                for (size_t r = 0; r < mu; ++r) rank_mu += weights[r] * y[order[r]][i] * y[order[r]][j];
+                cov[i][j] = (1 - c1 - cmu) * cov[i][j] + c1 * (pc[i] * pc[j] + rank_one_correction * cov[i][j]) + cmu * rank_mu;
+            }
+        }
+        sigma *= std::exp((cs / damps) * (ps_norm / chi_n - 1));
+
+        std::vector<double> eigenvalues;
+        symmetric_eigen(cov, basis, eigenvalues);
+        for (size_t i = 0; i < n; ++i) eigen_d[i] = std::sqrt(std::max(eigenvalues[i], 1e-20));
+
+        // Converged once the search distribution is smaller than the cache grid
+        double largest = *std::max_element(eigen_d.begin(), eigen_d.end());
+        if (sigma * largest < 1.0 / kGridResolution) break;
+    }
+
+    result.seconds = elapsed();
+    return result;
+}
+
+void save_calibration(const CalibrationConfig& config, const CalibrationResult& result, const std::string& filepath) {
+    std::ofstream outfile(filepath);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return;
+    }
+
+    outfile << "parameter,value\n";
+    for (size_t i = 0; i < result.best_params.size(); ++i) {
+        outfile << config.ranges[i].name << "," << result.best_params[i] << "\n";
+    }
+    outfile << "loss," << result.best_loss << "\n";
+    outfile << "mean_final_weight," << result.best_mean << "\n";
+    outfile << "std_final_weight," << result.best_std << "\n";
+    outfile << "evaluations," << result.evaluations << "\n";
+    outfile << "cache_hits," << result.cache_hits << "\n";
+}
@@ -0,0 +1,66 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "ensemble.h"
+#include "thread_pool.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Observed region statistics the calibration tries to reproduce
+struct CalibrationTarget {
+    double mean_final_weight;
+    double std_final_weight = -1; // < 0: not part of the objective
+};
+
+struct CalibrationConfig {
+    EnsembleConfig base;                // fixed parameters, replicas per evaluation and seed
+    std::vector<ParameterRange> ranges; // searched parameters and their bounds
+    CalibrationTarget target;
+    size_t max_runs = 200000;           // budget in simulated replicas (evaluations * base.replicas)
+    double max_seconds = 0;             // wall-clock budget, 0 = none
+    size_t population = 0;              // candidates per generation, 0 = 4 + 3 ln(d)
+    double initial_sigma = 0.3;         // initial step size in the unit-scaled search box
+};
+
+struct CalibrationResult {
+    std::vector<double> best_params; // in `ranges` order
+    double best_loss;
+    double best_mean;
+    double best_std;
+    size_t evaluations;  // distinct points simulated
+    size_t cache_hits;   // candidates answered from the cache
+    size_t generations;
+    double seconds;
+};
+
+// CMA-ES (Hansen's (mu/mu_w, lambda) variant with rank-one and rank-mu updates)
+// over the parameter box, scaled to [0, 1]^d. Each generation's candidates are
+// evaluated in parallel on the pool; points are snapped to a fine grid and
+// memoized, so candidates that land on a point already seen (typically on the
+// bounds) cost nothing.
+class Calibrator {
+public:
+    Calibrator(const CalibrationConfig& config, ThreadPool& pool);
+    CalibrationResult run();
+
+private:
+    struct Evaluation {
+        double loss;
+        double mean;
+        double std_dev;
+    };
+    typedef std::vector<long long> GridKey;
+
+    GridKey snap(std::vector<double>& unit_point) const;
+    Evaluation evaluate(const std::vector<double>& unit_point) const;
+    std::vector<double> to_params(const std::vector<double>& unit_point) const;
+
+    CalibrationConfig config;
+    ThreadPool& pool;
+    std::map<GridKey, Evaluation> cache;
+};
+
+void save_calibration(const CalibrationConfig& config, const CalibrationResult& result, const std::string& filepath);
+
+#endif // CALIBRATION_H
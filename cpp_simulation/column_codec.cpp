@@ -0,0 +1,401 @@
+#include "column_codec.h"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+namespace {
+
+uint64_t to_bits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double from_bits(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void put_u64(std::vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+uint64_t get_u64(const uint8_t* data) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) value = (value << 8) | data[i];
+    return value;
+}
+
+// MSB-first bit stream shared by the time and Gorilla encodings
+class BitStreamWriter {
+public:
+    explicit BitStreamWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    void put(uint64_t value, int bits) {
+        if (bits > 32) {
+            put(value >> 32, bits - 32);
+            bits = 32;
+        }
+        acc = (acc << bits) | (value & ((uint64_t(1) << bits) - 1));
+        used += bits;
+        while (used >= 8) {
+            out.push_back(static_cast<uint8_t>(acc >> (used - 8)));
+            used -= 8;
+        }
+    }
+
+    void flush() {
+        if (used > 0) out.push_back(static_cast<uint8_t>(acc << (8 - used)));
+        used = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t acc = 0;
+    int used = 0;
+};
+
+class BitStreamReader {
+public:
+    BitStreamReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    // Reads up to 32 bits from an unaligned 8-byte big-endian window
+    uint64_t get(int bits) {
+        if (bits > 32) {
+            uint64_t high = get(bits - 32);
+            return (high << 32) | get(32);
+        }
+        if (bits == 0) return 0;
+        if (pos + bits > size * 8) {
+            failed = true;
+            return 0;
+        }
+        size_t byte = pos >> 3;
+        uint64_t window = 0;
+        for (size_t i = 0; i < 8; ++i) window = (window << 8) | (byte + i < size ? data[byte + i] : 0);
+        uint64_t value = (window << (pos & 7)) >> (64 - bits);
+        pos += bits;
+        return value;
+    }
+
+    bool ok() const { return !failed; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool failed = false;
+};
+
+void encode_gorilla_block(const double* values, size_t n, std::vector<uint8_t>& out) {
+    BitStreamWriter writer(out);
+    uint64_t previous = to_bits(values[0]);
+    writer.put(previous, 64);
+    int leading = -1, trailing = 0; // current meaningful-bit window, none yet
+    for (size_t i = 1; i < n; ++i) {
+        uint64_t current = to_bits(values[i]);
+        uint64_t x = current ^ previous;
+        previous = current;
+        if (x == 0) {
+            writer.put(0, 1);
+            continue;
+        }
+        int lead = __builtin_clzll(x);
+        int trail = __builtin_ctzll(x);
+        if (lead > 31) lead = 31;
+        if (leading >= 0 && lead >= leading && trail >= trailing) {
+            // Fits the previous window: only the meaningful bits
+            writer.put(2, 2);
+            writer.put(x >> trailing, 64 - leading - trailing);
+        } else {
+            int meaningful = 64 - lead - trail;
+            writer.put(3, 2);
+            writer.put(static_cast<uint64_t>(lead), 5);
+            writer.put(static_cast<uint64_t>(meaningful & 63), 6); // 64 is stored as 0
+            writer.put(x >> trail, meaningful);
+            leading = lead;
+            trailing = trail;
+        }
+    }
+    writer.flush();
+}
+
+bool decode_gorilla_block(const uint8_t* data, size_t size, double* values, size_t n) {
+    BitStreamReader reader(data, size);
+    uint64_t previous = reader.get(64);
+    values[0] = from_bits(previous);
+    int leading = 0, trailing = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (reader.get(1) != 0) {
+            if (reader.get(1) != 0) {
+                leading = static_cast<int>(reader.get(5));
+                int meaningful = static_cast<int>(reader.get(6));
+                if (meaningful == 0) meaningful = 64;
+                trailing = 64 - leading - meaningful;
+                if (trailing < 0) return false;
+            }
+            previous ^= reader.get(64 - leading - trailing) << trailing;
+        }
+        values[i] = from_bits(previous);
+    }
+    return reader.ok();
+}
+
+// Rounds to the nearest double with `bits` explicit mantissa bits (ties away from zero)
+double round_mantissa(double value, int bits) {
+    if (bits >= 52 || bits < 0) return value;
+    uint64_t raw = to_bits(value);
+    uint64_t exponent = (raw >> 52) & 0x7FF;
+    if (exponent == 0x7FF) return value; // inf or nan
+    int drop = 52 - bits;
+    uint64_t half = uint64_t(1) << (drop - 1);
+    raw = (raw + half) & ~((uint64_t(1) << drop) - 1); // a carry into the exponent is still correct
+    return from_bits(raw);
+}
+
+} // namespace
+
+// --- Column Encodings ---
+
+// Delta-of-delta bucket codes (Gorilla timestamps): '0' for zero, then prefix + signed field
+struct DodBucket {
+    uint64_t prefix;
+    int prefix_bits;
+    int value_bits;
+};
+const DodBucket kDodBuckets[] = {{2, 2, 7}, {6, 3, 12}, {14, 4, 20}, {15, 4, 64}};
+
+void encode_delta_of_delta(const double* values, size_t n, std::vector<uint8_t>& out) {
+    BitStreamWriter writer(out);
+    uint64_t previous = 0, previous_delta = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t current = to_bits(values[i]);
+        uint64_t delta = current - previous;
+        int64_t dod = static_cast<int64_t>(delta - previous_delta);
+        previous = current;
+        previous_delta = delta;
+        if (dod == 0) {
+            writer.put(0, 1);
+            continue;
+        }
+        for (const DodBucket& bucket : kDodBuckets) {
+            int64_t limit = bucket.value_bits < 64 ? int64_t(1) << (bucket.value_bits - 1) : 0;
+            if (bucket.value_bits == 64 || (dod >= -limit && dod < limit)) {
+                writer.put(bucket.prefix, bucket.prefix_bits);
+                writer.put(static_cast<uint64_t>(dod), bucket.value_bits);
+                break;
+            }
+        }
+    }
+    writer.flush();
+}
+
+bool decode_delta_of_delta(const uint8_t* data, size_t size, double* values, size_t n) {
+    BitStreamReader reader(data, size);
+    uint64_t current = 0, delta = 0;
+    for (size_t i = 0; i < n; ++i) {
+        int ones = 0;
+        while (ones < 4 && reader.get(1) == 1) ++ones;
+        if (ones > 0) {
+            int bits = kDodBuckets[ones - 1].value_bits;
+            uint64_t field = reader.get(bits);
+            // Sign-extend the field back to 64 bits
+            if (bits < 64 && (field >> (bits - 1)) & 1) field |= ~uint64_t(0) << bits;
+            delta += field;
+        }
+        current += delta;
+        values[i] = from_bits(current);
+    }
+    return reader.ok();
+}
+
+bool encode_bit_packed(const double* values, size_t n, std::vector<uint8_t>& out) {
+    std::vector<uint64_t> words((n + 63) / 64, 0);
+    for (size_t i = 0; i < n; ++i) {
+        if (values[i] != 0.0 && values[i] != 1.0) return false;
+        words[i / 64] |= static_cast<uint64_t>(values[i] != 0.0) << (i % 64);
+    }
+    for (uint64_t word : words) put_u64(out, word);
+    return true;
+}
+
+bool decode_bit_packed(const uint8_t* data, size_t size, double* values, size_t n) {
+    size_t words = (n + 63) / 64;
+    if (size != words * 8) return false;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t word = get_u64(data + 8 * w);
+        size_t count = n - w * 64 < 64 ? n - w * 64 : 64;
+        double* out = values + w * 64;
+        for (size_t j = 0; j < count; ++j) out[j] = static_cast<double>((word >> j) & 1);
+    }
+    return true;
+}
+
+void encode_gorilla(const double* values, size_t n, std::vector<uint8_t>& out) {
+    // Layout: uint64 block count, uint64 end offset of each block, then the blocks
+    size_t blocks = (n + kGorillaBlock - 1) / kGorillaBlock;
+    std::vector<uint8_t> body;
+    std::vector<uint64_t> ends;
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t first = b * kGorillaBlock;
+        size_t count = n - first < kGorillaBlock ? n - first : kGorillaBlock;
+        encode_gorilla_block(values + first, count, body);
+        ends.push_back(body.size());
+    }
+    put_u64(out, blocks);
+    for (uint64_t end : ends) put_u64(out, end);
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+bool decode_gorilla(const uint8_t* data, size_t size, double* values, size_t n, ThreadPool* pool) {
+    if (size < 8) return false;
+    size_t blocks = get_u64(data);
+    if (blocks != (n + kGorillaBlock - 1) / kGorillaBlock || size < 8 + 8 * blocks) return false;
+    const uint8_t* body = data + 8 + 8 * blocks;
+    size_t body_size = size - 8 - 8 * blocks;
+
+    std::atomic<bool> ok(true);
+    auto decode_range = [&](size_t begin, size_t end, size_t) {
+        for (size_t b = begin; b < end; ++b) {
+            uint64_t start = b == 0 ? 0 : get_u64(data + 8 * b);
+            uint64_t stop = get_u64(data + 8 + 8 * b);
+            size_t first = b * kGorillaBlock;
+            size_t count = n - first < kGorillaBlock ? n - first : kGorillaBlock;
+            if (start > stop || stop > body_size || !decode_gorilla_block(body + start, stop - start, values + first, count)) {
+                ok = false;
+            }
+        }
+    };
+    if (pool && blocks > 1) {
+        pool->parallel_for(blocks, 1, decode_range);
+    } else {
+        decode_range(0, blocks, 0);
+    }
+    return ok;
+}
+
+// --- Compressed Trajectory Files ---
+
+bool save_compressed(const std::string& filepath, const SimRows& rows, int weight_mantissa_bits) {
+    // One segment per region, in order of first appearance
+    std::vector<std::string> names;
+    std::map<std::string, std::vector<const SimData*>> segments;
+    for (const auto& row : rows) {
+        auto& segment = segments[row.region];
+        if (segment.empty()) names.push_back(row.region);
+        segment.push_back(&row);
+    }
+
+    std::vector<uint8_t> out(std::begin("QDCOL1\0"), std::end("QDCOL1\0"));
+    uint32_t header[2] = {1, static_cast<uint32_t>(names.size())};
+    out.insert(out.end(), reinterpret_cast<uint8_t*>(header), reinterpret_cast<uint8_t*>(header) + sizeof(header));
+
+    std::vector<double> column;
+    std::vector<uint8_t> encoded;
+    for (const auto& name : names) {
+        const auto& segment = segments[name];
+        uint16_t length = static_cast<uint16_t>(name.size());
+        out.push_back(static_cast<uint8_t>(length));
+        out.push_back(static_cast<uint8_t>(length >> 8));
+        out.insert(out.end(), name.begin(), name.begin() + length);
+        put_u64(out, segment.size());
+
+        for (int c = 0; c < 4; ++c) {
+            column.clear();
+            for (const SimData* row : segment) {
+                column.push_back(c == 0 ? row->time : c == 1 ? row->pre_activity : c == 2 ? row->post_activity
+                                                                                 : round_mantissa(row->synaptic_weight, weight_mantissa_bits));
+            }
+            encoded.clear();
+            ColumnEncoding encoding = ColumnEncoding::Gorilla;
+            if (c == 0) {
+                encoding = ColumnEncoding::DeltaOfDelta;
+                encode_delta_of_delta(column.data(), column.size(), encoded);
+            } else if (c < 3 && encode_bit_packed(column.data(), column.size(), encoded)) {
+                encoding = ColumnEncoding::BitPacked;
+            } else {
+                encode_gorilla(column.data(), column.size(), encoded);
+            }
+            out.push_back(static_cast<uint8_t>(encoding));
+            put_u64(out, encoded.size());
+            out.insert(out.end(), encoded.begin(), encoded.end());
+        }
+    }
+
+    std::ofstream outfile(filepath, std::ios::binary);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return false;
+    }
+    outfile.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(outfile);
+}
+
+namespace {
+
+// Whether `bytes` of a column can hold `n` rows, checked before allocating them:
+// bit-packed columns are exact, and the bit streams spend at least one bit per row
+bool rows_fit(ColumnEncoding encoding, size_t bytes, size_t n) {
+    if (encoding == ColumnEncoding::BitPacked) return bytes % 8 == 0 && bytes / 8 == n / 64 + (n % 64 != 0);
+    return n <= 8 * bytes; // bytes is bounded by the file size, so this cannot overflow
+}
+
+} // namespace
+
+bool load_compressed(const std::string& filepath, SimRows& rows, ThreadPool* pool) {
+    std::ifstream infile(filepath, std::ios::binary);
+    if (!infile.is_open()) {
+        std::cerr << "Error: Could not open compressed file " << filepath << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+    const uint8_t* data = file.data();
+    const size_t size = file.size();
+    auto corrupt = [&filepath]() {
+        std::cerr << "Error: " << filepath << " is not a valid compressed trajectory." << std::endl;
+        return false;
+    };
+    if (size < 16 || std::memcmp(data, "QDCOL1\0", 8) != 0) return corrupt();
+    uint32_t header[2];
+    std::memcpy(header, data + 8, sizeof(header));
+    if (header[0] != 1) return corrupt();
+
+    rows.clear();
+    size_t pos = 16;
+    std::vector<double> columns[4];
+    for (uint32_t s = 0; s < header[1]; ++s) {
+        if (pos + 2 > size) return corrupt();
+        size_t length = data[pos] | (data[pos + 1] << 8);
+        pos += 2;
+        if (pos + length + 8 > size) return corrupt();
+        std::string region(reinterpret_cast<const char*>(data + pos), length);
+        pos += length;
+        size_t n = get_u64(data + pos);
+        pos += 8;
+
+        for (int c = 0; c < 4; ++c) {
+            if (pos + 9 > size) return corrupt();
+            ColumnEncoding encoding = static_cast<ColumnEncoding>(data[pos]);
+            size_t bytes = get_u64(data + pos + 1);
+            pos += 9;
+            if (bytes > size - pos || !rows_fit(encoding, bytes, n)) return corrupt();
+            columns[c].resize(n);
+            bool ok = false;
+            if (encoding == ColumnEncoding::DeltaOfDelta) ok = decode_delta_of_delta(data + pos, bytes, columns[c].data(), n);
+            else if (encoding == ColumnEncoding::BitPacked) ok = decode_bit_packed(data + pos, bytes, columns[c].data(), n);
+            else if (encoding == ColumnEncoding::Gorilla) ok = decode_gorilla(data + pos, bytes, columns[c].data(), n, pool);
+            if (!ok) return corrupt();
+            pos += bytes;
+        }
+
+        rows.reserve(rows.size() + n);
+        for (size_t i = 0; i < n; ++i) {
+            rows.push_back({columns[0][i], columns[1][i], columns[2][i], columns[3][i], region});
+        }
+    }
+    return pos == size ? true : corrupt();
+}
@@ -0,0 +1,49 @@
+#ifndef COLUMN_CODEC_H
+#define COLUMN_CODEC_H
+
+#include "synapse.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lossless compressed column encodings for trajectories:
+//   time      delta-of-delta of the IEEE bit patterns, Gorilla timestamp buckets
+//   weights   Gorilla XOR coding (Pelkonen et al. 2015) in independent blocks
+//   activity  one bit per row when the column is 0/1, Gorilla otherwise
+// Decoding is the hot path: time reads one bit per row while the step is constant
+// and adds the running delta, activity unpacks 64 rows per word in a branch-free
+// loop, and Gorilla blocks decode in parallel.
+
+enum class ColumnEncoding : uint8_t {
+    DeltaOfDelta = 1,
+    BitPacked = 2,
+    Gorilla = 3
+};
+
+// Rows per Gorilla block; each block restarts the XOR chain so blocks decode independently
+const size_t kGorillaBlock = 4096;
+
+void encode_delta_of_delta(const double* values, size_t n, std::vector<uint8_t>& out);
+bool decode_delta_of_delta(const uint8_t* data, size_t size, double* values, size_t n);
+
+// Returns false (writing nothing) if a value is neither 0 nor 1
+bool encode_bit_packed(const double* values, size_t n, std::vector<uint8_t>& out);
+bool decode_bit_packed(const uint8_t* data, size_t size, double* values, size_t n);
+
+void encode_gorilla(const double* values, size_t n, std::vector<uint8_t>& out);
+bool decode_gorilla(const uint8_t* data, size_t size, double* values, size_t n, ThreadPool* pool = nullptr);
+
+// Compressed trajectory file (.qdc): one segment per region, each holding the
+// time, pre_activity, post_activity and synaptic_weight columns.
+//   "QDCOL1\0\0", uint32 version (1), uint32 segments, then per segment:
+//   uint16 region length, region bytes, uint64 rows, and per column
+//   uint8 ColumnEncoding, uint64 byte length, encoded bytes.
+// `weight_mantissa_bits` below 52 rounds weights to that many mantissa bits first
+// (lossy, but XOR coding then drops the zeroed low bits); 21 bits still prints
+// identically at the 6 significant digits save_results writes.
+bool save_compressed(const std::string& filepath, const SimRows& rows, int weight_mantissa_bits = 52);
+bool load_compressed(const std::string& filepath, SimRows& rows, ThreadPool* pool = nullptr);
+
+#endif // COLUMN_CODEC_H
@@ -0,0 +1,104 @@
+#include "correlated_spikes.h"
+#include "ensemble.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// --- CorrelatedSpikeGenerator Class Implementation ---
+
+CorrelatedSpikeGenerator::CorrelatedSpikeGenerator(const std::vector<double>& rates, const std::vector<double>& correlations,
+                                                   double dt, uint64_t seed) {
+    if (rates.size() != correlations.size() || !(dt > 0)) {
+        std::cerr << "Error: Correlated spikes need one correlation per rate and a positive dt." << std::endl;
+        return;
+    }
+    for (size_t i = 0; i < rates.size(); ++i) {
+        if (!(rates[i] >= 0) || !(correlations[i] >= 0 && correlations[i] <= 1)) {
+            std::cerr << "Error: Channel " << i << " needs a rate >= 0 and a correlation in [0, 1]." << std::endl;
+            probability.clear();
+            share.clear();
+            keys.clear();
+            return;
+        }
+        probability.push_back(1.0 - std::exp(-rates[i] * dt));
+        share.push_back(std::sqrt(correlations[i]));
+        keys.push_back(CounterRng::replica_key(seed, i + 1));
+    }
+    shared_key = CounterRng::replica_key(seed, 0);
+}
+
+void CorrelatedSpikeGenerator::step(uint64_t step, uint8_t* spikes) const {
+    const double shared = CounterRng::uniform(shared_key, step);
+    const size_t n = probability.size();
+    // Both draws are taken for every channel so the loop has no data-dependent branch
+    for (size_t i = 0; i < n; ++i) {
+        double select = CounterRng::uniform(keys[i], 2 * step);
+        double own = CounterRng::uniform(keys[i], 2 * step + 1);
+        double u = select < share[i] ? shared : own;
+        spikes[i] = u < probability[i] ? 1 : 0;
+    }
+}
+
+void CorrelatedSpikeGenerator::fill(uint64_t begin, uint64_t end, FirstTouchVector<uint8_t>& raster, ThreadPool* pool,
+                                    size_t grain) const {
+    const size_t n = probability.size();
+    const size_t steps = end > begin ? static_cast<size_t>(end - begin) : 0;
+    // Left uninitialized: step() writes every entry, and the writer places the pages
+    raster.resize(steps * n);
+    auto run = [&](size_t first, size_t last, size_t) {
+        for (size_t s = first; s < last; ++s) step(begin + s, raster.data() + s * n);
+    };
+    if (pool && pool->worker_node(0) >= 0) {
+        pool->parallel_for_partitioned(steps, [&](size_t first, size_t last, size_t worker) {
+            bind_to_node(raster.data() + first * n, (last - first) * n, pool->worker_node(worker));
+            run(first, last, worker);
+        });
+    } else if (pool) {
+        pool->parallel_for(steps, std::max<size_t>(1, grain / std::max<size_t>(n, 1)), run);
+    } else {
+        run(0, steps, 0);
+    }
+}
+
+double CorrelatedSpikeGenerator::pair_correlation(size_t i, size_t j) const {
+    if (i == j) return 1.0;
+    const double pi = probability[i], pj = probability[j];
+    const double variance = pi * (1 - pi) * pj * (1 - pj);
+    if (variance <= 0) return 0.0;
+    return share[i] * share[j] * (std::min(pi, pj) - pi * pj) / std::sqrt(variance);
+}
+
+// --- CorrelatedActivity Class Implementation ---
+
+double CorrelatedActivity::max_correlation(double pre_rate, double post_rate, double dt) {
+    // pair_correlation with both shares at 1
+    const double p = 1.0 - std::exp(-pre_rate * dt), q = 1.0 - std::exp(-post_rate * dt);
+    const double variance = p * (1 - p) * q * (1 - q);
+    return variance > 0 ? (std::min(p, q) - p * q) / std::sqrt(variance) : 0.0;
+}
+
+// Both channels get the share sqrt(correlation / max), so the pair hits the requested value
+static double matched_correlation(double pre_rate, double post_rate, double correlation, double dt) {
+    const double max = CorrelatedActivity::max_correlation(pre_rate, post_rate, dt);
+    if (!(correlation > 0) || !(max > 0)) return correlation;
+    return std::min(1.0, correlation / max);
+}
+
+CorrelatedActivity::CorrelatedActivity(double pre_rate, double post_rate, double correlation, double dt, uint64_t seed)
+    : generator({pre_rate, post_rate}, std::vector<double>(2, matched_correlation(pre_rate, post_rate, correlation, dt)),
+                dt, seed) {
+    if (generator.num_channels() != 2) return;
+    const double max = max_correlation(pre_rate, post_rate, dt);
+    if (correlation > max) {
+        std::cerr << "Error: spike_correlation " << correlation << " is out of reach for rates " << pre_rate << " and "
+                  << post_rate << " Hz at dt " << dt << "; the most these trains can share is " << max << "." << std::endl;
+        reachable = false;
+    }
+}
+
+void CorrelatedActivity::next(double, double, double& pre_activity, double& post_activity) {
+    uint8_t spikes[2];
+    generator.step(steps++, spikes);
+    pre_activity = spikes[0];
+    post_activity = spikes[1];
+}
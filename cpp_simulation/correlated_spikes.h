@@ -0,0 +1,64 @@
+#ifndef CORRELATED_SPIKES_H
+#define CORRELATED_SPIKES_H
+
+#include "synapse.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Populations of discretized Poisson spike trains with controlled pairwise
+// correlation, by shared-input mixture. Each step draws one shared uniform S;
+// channel i copies it with probability a_i = sqrt(c_i) and otherwise draws its
+// own uniform V_i, then spikes if that value is below p_i = 1 - exp(-rate_i dt).
+// Marginals are exactly Bernoulli(p_i) and the spike-count correlation of
+// channels i and j is
+//     a_i a_j (min(p_i, p_j) - p_i p_j) / sqrt(p_i (1 - p_i) p_j (1 - p_j)),
+// i.e. sqrt(c_i c_j) for equal rates. A step costs O(N) with no per-pair work.
+// Draws are counter-based (CounterRng), so any block of steps or channels can
+// be generated independently and in parallel with identical results.
+class CorrelatedSpikeGenerator {
+public:
+    // `correlations` are each channel's c_i in [0, 1]; returns an empty generator
+    // (num_channels() == 0) after reporting an error on mismatched or invalid inputs
+    CorrelatedSpikeGenerator(const std::vector<double>& rates, const std::vector<double>& correlations, double dt,
+                             uint64_t seed);
+
+    size_t num_channels() const { return probability.size(); }
+    // Spikes (0 or 1) of every channel during step `step`
+    void step(uint64_t step, uint8_t* spikes) const;
+    // Steps [begin, end) as a row-major steps x channels raster, split over `pool`
+    // in tasks of about `grain` channel-steps each. On a pool with pinned workers,
+    // each worker instead fills a fixed slice of steps held on its own NUMA node.
+    void fill(uint64_t begin, uint64_t end, FirstTouchVector<uint8_t>& raster, ThreadPool* pool = nullptr,
+              size_t grain = 65536) const;
+    // Analytic spike-count correlation of channels i and j within one step
+    double pair_correlation(size_t i, size_t j) const;
+
+private:
+    std::vector<double> probability; // p_i
+    std::vector<double> share;       // a_i
+    std::vector<uint64_t> keys;      // per-channel stream keys
+    uint64_t shared_key = 0;
+};
+
+// Two-channel generator (pre, post) as the activity of Simulation::run. Unlike
+// the population generator, the pair's correlation is exactly `correlation`:
+// the shares are scaled by the most that unequal rates allow, and a larger
+// value is reported as an error (is_valid() false).
+class CorrelatedActivity : public ActivitySource {
+public:
+    CorrelatedActivity(double pre_rate, double post_rate, double correlation, double dt, uint64_t seed);
+    bool is_valid() const { return generator.num_channels() == 2 && reachable; }
+    void next(double t, double dt, double& pre_activity, double& post_activity) override;
+
+    // Highest spike-count correlation two trains with these rates can have (1 for equal rates)
+    static double max_correlation(double pre_rate, double post_rate, double dt);
+
+private:
+    CorrelatedSpikeGenerator generator;
+    uint64_t steps = 0;
+    bool reachable = true;
+};
+
+#endif // CORRELATED_SPIKES_H
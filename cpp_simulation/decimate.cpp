@@ -0,0 +1,129 @@
+#include "decimate.h"
+#include <cmath>
+#include <iostream>
+#include <map>
+
+namespace {
+
+std::vector<size_t> all_indices(size_t n) {
+    std::vector<size_t> indices(n);
+    for (size_t i = 0; i < n; ++i) indices[i] = i;
+    return indices;
+}
+
+} // namespace
+
+std::vector<size_t> lttb_indices(const SimRows& rows, size_t points) {
+    const size_t n = rows.size();
+    if (points >= n || points < 3) return all_indices(n);
+
+    std::vector<size_t> selected;
+    selected.reserve(points);
+    selected.push_back(0);
+
+    // The interior rows split into points - 2 buckets
+    const double bucket = static_cast<double>(n - 2) / (points - 2);
+    size_t a = 0;
+    for (size_t b = 0; b < points - 2; ++b) {
+        size_t begin = static_cast<size_t>(std::floor(b * bucket)) + 1;
+        size_t end = static_cast<size_t>(std::floor((b + 1) * bucket)) + 1;
+
+        // Third vertex: the average of the next bucket (the last row for the final bucket)
+        size_t next_begin = end;
+        size_t next_end = static_cast<size_t>(std::floor((b + 2) * bucket)) + 1;
+        if (next_end > n) next_end = n;
+        double avg_time = 0, avg_weight = 0;
+        if (b + 1 == points - 2) {
+            avg_time = rows[n - 1].time;
+            avg_weight = rows[n - 1].synaptic_weight;
+        } else {
+            for (size_t i = next_begin; i < next_end; ++i) {
+                avg_time += rows[i].time;
+                avg_weight += rows[i].synaptic_weight;
+            }
+            avg_time /= (next_end - next_begin);
+            avg_weight /= (next_end - next_begin);
+        }
+
+        const double ax = rows[a].time, ay = rows[a].synaptic_weight;
+        double best_area = -1;
+        size_t best = begin;
+        for (size_t i = begin; i < end; ++i) {
+            double area = std::fabs((ax - avg_time) * (rows[i].synaptic_weight - ay) -
+                                    (ax - rows[i].time) * (avg_weight - ay));
+            if (area > best_area) {
+                best_area = area;
+                best = i;
+            }
+        }
+        selected.push_back(best);
+        a = best;
+    }
+
+    selected.push_back(n - 1);
+    return selected;
+}
+
+std::vector<size_t> minmax_indices(const SimRows& rows, size_t points) {
+    const size_t n = rows.size();
+    if (points >= n || points < 4) return all_indices(n);
+
+    std::vector<size_t> selected;
+    selected.reserve(points);
+    selected.push_back(0);
+
+    const size_t buckets = (points - 2) / 2;
+    const double bucket = static_cast<double>(n - 2) / buckets;
+    for (size_t b = 0; b < buckets; ++b) {
+        size_t begin = static_cast<size_t>(std::floor(b * bucket)) + 1;
+        size_t end = static_cast<size_t>(std::floor((b + 1) * bucket)) + 1;
+        size_t lo = begin, hi = begin;
+        for (size_t i = begin; i < end; ++i) {
+            if (rows[i].synaptic_weight < rows[lo].synaptic_weight) lo = i;
+            if (rows[i].synaptic_weight > rows[hi].synaptic_weight) hi = i;
+        }
+        selected.push_back(lo < hi ? lo : hi);
+        if (lo != hi) selected.push_back(lo < hi ? hi : lo);
+    }
+
+    selected.push_back(n - 1);
+    return selected;
+}
+
+bool decimate_regions(const SimRows& rows, size_t points, const std::string& method, ThreadPool& pool,
+                      SimRows& decimated) {
+    if (method != "lttb" && method != "minmax") {
+        std::cerr << "Error: Unknown decimate_method '" << method << "' (expected lttb or minmax)." << std::endl;
+        return false;
+    }
+
+    // Split by region, keeping the order in which regions first appear. Only row
+    // numbers are gathered here; each worker copies its own regions' rows, so they
+    // are allocated on the worker's NUMA node when the pool is pinned.
+    std::vector<std::vector<size_t>> members;
+    std::map<std::string, size_t> slot;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        auto found = slot.find(rows[i].region);
+        if (found == slot.end()) {
+            found = slot.emplace(rows[i].region, members.size()).first;
+            members.emplace_back();
+        }
+        members[found->second].push_back(i);
+    }
+
+    std::vector<std::vector<size_t>> selected(members.size());
+    pool.parallel_for(members.size(), 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t r = begin; r < end; ++r) {
+            SimRows region;
+            region.reserve(members[r].size());
+            for (size_t i : members[r]) region.push_back(rows[i]);
+            selected[r] = method == "lttb" ? lttb_indices(region, points) : minmax_indices(region, points);
+        }
+    });
+
+    decimated.clear();
+    for (size_t r = 0; r < members.size(); ++r) {
+        for (size_t i : selected[r]) decimated.push_back(rows[members[r][i]]);
+    }
+    return true;
+}
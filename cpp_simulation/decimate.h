@@ -0,0 +1,27 @@
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include "synapse.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Visually faithful subsets of a weight trajectory for plotting. Both methods
+// return increasing row indices that always include the first and last row, so
+// the selected rows keep every column and can be written with write_results.
+
+// Largest-Triangle-Three-Buckets (Steinarsson 2013): one row per bucket, the one
+// forming the largest triangle with its chosen neighbours
+std::vector<size_t> lttb_indices(const SimRows& rows, size_t points);
+// The minimum and maximum weight row of each bucket, in time order; keeps every
+// excursion of the curve at the cost of two rows per bucket
+std::vector<size_t> minmax_indices(const SimRows& rows, size_t points);
+
+// Decimates each region's rows to at most `points` rows with `method` ("lttb" or
+// "minmax"), one region per worker; regions come back in their input order.
+// Returns false for an unknown method.
+bool decimate_regions(const SimRows& rows, size_t points, const std::string& method, ThreadPool& pool,
+                      SimRows& decimated);
+
+#endif // DECIMATE_H
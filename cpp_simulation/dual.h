@@ -0,0 +1,83 @@
+#ifndef DUAL_H
+#define DUAL_H
+
+// Forward-mode automatic differentiation: a value carrying N tangent directions,
+// so one pass through a kernel yields its derivative with respect to N inputs.
+template <int N>
+struct Dual {
+    double value;
+    double grad[N];
+
+    Dual(double v = 0.0) : value(v) {
+        for (int i = 0; i < N; ++i) grad[i] = 0.0;
+    }
+
+    // Independent variable: unit tangent in direction `index`
+    static Dual variable(double v, int index) {
+        Dual d(v);
+        d.grad[index] = 1.0;
+        return d;
+    }
+
+    Dual& operator+=(const Dual& o) {
+        value += o.value;
+        for (int i = 0; i < N; ++i) grad[i] += o.grad[i];
+        return *this;
+    }
+};
+
+template <int N>
+inline Dual<N> operator-(const Dual<N>& a) {
+    Dual<N> r(-a.value);
+    for (int i = 0; i < N; ++i) r.grad[i] = -a.grad[i];
+    return r;
+}
+
+template <int N>
+inline Dual<N> operator+(const Dual<N>& a, const Dual<N>& b) {
+    Dual<N> r(a.value + b.value);
+    for (int i = 0; i < N; ++i) r.grad[i] = a.grad[i] + b.grad[i];
+    return r;
+}
+
+template <int N>
+inline Dual<N> operator-(const Dual<N>& a, const Dual<N>& b) {
+    Dual<N> r(a.value - b.value);
+    for (int i = 0; i < N; ++i) r.grad[i] = a.grad[i] - b.grad[i];
+    return r;
+}
+
+template <int N>
+inline Dual<N> operator*(const Dual<N>& a, const Dual<N>& b) {
+    Dual<N> r(a.value * b.value);
+    for (int i = 0; i < N; ++i) r.grad[i] = a.grad[i] * b.value + a.value * b.grad[i];
+    return r;
+}
+
+template <int N>
+inline Dual<N> operator*(const Dual<N>& a, double b) {
+    Dual<N> r(a.value * b);
+    for (int i = 0; i < N; ++i) r.grad[i] = a.grad[i] * b;
+    return r;
+}
+
+template <int N>
+inline Dual<N> operator*(double a, const Dual<N>& b) {
+    return b * a;
+}
+
+// Comparisons look at the value only, so a clamp selects a constant branch
+// whose tangent is zero: the subgradient of min/max at an active bound.
+template <int N>
+inline bool operator>(const Dual<N>& a, double b) { return a.value > b; }
+
+template <int N>
+inline bool operator<(const Dual<N>& a, double b) { return a.value < b; }
+
+// Plain doubles pass through the same templated kernels unchanged
+inline double value_of(double x) { return x; }
+
+template <int N>
+inline double value_of(const Dual<N>& x) { return x.value; }
+
+#endif // DUAL_H
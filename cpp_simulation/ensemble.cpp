@@ -0,0 +1,239 @@
+#include "ensemble.h"
+#include "synapse.h"
+#include <iostream>
+
+// --- Ensemble Class Implementation ---
+
+Ensemble::Ensemble(const EnsembleConfig& config)
+    : config(config),
+      steps(count_steps(config.sim_duration, config.dt)) {
+    if (this->config.record_every == 0) this->config.record_every = 1;
+    if (this->config.lanes != 4 && this->config.lanes != 16) this->config.lanes = 8;
+    if (this->config.sampling == Sampling::QuasiMonteCarlo) {
+        // Sobol stratification needs power-of-two point sets that fill whole blocks
+        size_t points = static_cast<size_t>(this->config.lanes);
+        while (points < this->config.qmc_points) points *= 2;
+        // ...but small enough that the ensemble holds at least two sets, which a
+        // confidence interval needs (down to one block for tiny ensembles)
+        while (points > static_cast<size_t>(this->config.lanes) && 2 * points > this->config.replicas) points /= 2;
+        this->config.qmc_points = points;
+    }
+}
+
+size_t Ensemble::group_size() const {
+    switch (config.sampling) {
+        case Sampling::Antithetic: return 2;
+        case Sampling::QuasiMonteCarlo: return config.qmc_points;
+        default: return 1;
+    }
+}
+
+void Ensemble::run(EnsembleObserver& observer) const {
+    run_replicas(0, config.replicas, observer);
+}
+
+void Ensemble::run_replicas(size_t first, size_t count, EnsembleObserver& observer) const {
+    const size_t lanes = static_cast<size_t>(config.lanes);
+    for (size_t offset = 0; offset < count; offset += lanes) {
+        int active = static_cast<int>(count - offset < lanes ? count - offset : lanes);
+        switch (config.lanes) {
+            case 4: run_lanes<4>(first + offset, active, observer); break;
+            case 16: run_lanes<16>(first + offset, active, observer); break;
+            default: run_lanes<8>(first + offset, active, observer); break;
+        }
+    }
+}
+
+template <int Lanes>
+void Ensemble::run_lanes(size_t first_replica, int active, EnsembleObserver& observer) const {
+    switch (config.sampling) {
+        case Sampling::Antithetic: run_block<Lanes, Sampling::Antithetic>(first_replica, active, observer); break;
+        case Sampling::QuasiMonteCarlo: run_block<Lanes, Sampling::QuasiMonteCarlo>(first_replica, active, observer); break;
+        default: run_block<Lanes, Sampling::MonteCarlo>(first_replica, active, observer); break;
+    }
+}
+
+template <Sampling Mode>
+static inline double lane_uniform(uint64_t key, uint32_t index, uint64_t counter) {
+    if (Mode == Sampling::QuasiMonteCarlo) return OwenSobol::uniform(key, counter, index);
+    double u = CounterRng::uniform(key, counter);
+    // Antithetic lanes: index is 1 for the mirrored member of a pair
+    if (Mode == Sampling::Antithetic) return index ? 1.0 - u : u;
+    return u;
+}
+
+template <int Lanes, Sampling Mode>
+void Ensemble::run_block(size_t first_replica, int active, EnsembleObserver& observer) const {
+    // Structure-of-arrays lane state; every inner loop below runs over all lanes
+    // with no cross-lane dependency so the compiler can keep it in vector registers.
+    alignas(64) uint64_t key[Lanes];
+    alignas(64) uint32_t index[Lanes];
+    alignas(64) double weight[Lanes];
+    alignas(64) double pre[Lanes];
+    alignas(64) double post[Lanes];
+    alignas(64) double pre_spikes[Lanes];
+    alignas(64) double post_spikes[Lanes];
+    alignas(64) double paired_spikes[Lanes];
+
+    for (int l = 0; l < Lanes; ++l) {
+        size_t replica = first_replica + l;
+        switch (Mode) {
+            case Sampling::Antithetic:
+                key[l] = CounterRng::replica_key(config.seed, replica / 2);
+                index[l] = static_cast<uint32_t>(replica & 1);
+                break;
+            case Sampling::QuasiMonteCarlo:
+                key[l] = CounterRng::replica_key(config.seed, replica / config.qmc_points);
+                index[l] = static_cast<uint32_t>(replica % config.qmc_points);
+                break;
+            default:
+                key[l] = CounterRng::replica_key(config.seed, replica);
+                index[l] = 0;
+                break;
+        }
+        weight[l] = config.initial_weight;
+        pre_spikes[l] = post_spikes[l] = paired_spikes[l] = 0.0;
+    }
+
+    const double learning_rate = config.learning_rate;
+    const double decay_rate = config.decay_rate;
+    const double dt = config.dt;
+    const size_t record_every = config.record_every;
+
+    observer.begin_block(first_replica, active);
+
+    double t = 0;
+    for (size_t step = 0; step < steps; ++step, t += dt) {
+        const uint64_t counter = static_cast<uint64_t>(step) * kDrawsPerStep;
+        for (int l = 0; l < Lanes; ++l) {
+            double u_pre = lane_uniform<Mode>(key[l], index[l], counter);
+            double u_paired = lane_uniform<Mode>(key[l], index[l], counter + 1);
+            double u_spont = lane_uniform<Mode>(key[l], index[l], counter + 2);
+            random_activity(u_pre, u_paired, u_spont, pre[l], post[l]);
+            weight[l] = hebbian_step(weight[l], pre[l], post[l], learning_rate, decay_rate, dt);
+            pre_spikes[l] += pre[l];
+            post_spikes[l] += post[l];
+            paired_spikes[l] += pre[l] * post[l];
+        }
+        if (step % record_every == 0) {
+            observer.record(step / record_every, t, weight, pre, post, active);
+        }
+    }
+
+    BlockSummary summary = {first_replica, active, weight, pre_spikes, post_spikes, paired_spikes};
+    observer.end_block(summary);
+}
+
+// --- Parameter Helpers ---
+
+bool is_parameter(const std::string& name) {
+    return name == "learning_rate" || name == "decay_rate" || name == "initial_weight" ||
+           name == "dt" || name == "sim_duration";
+}
+
+bool set_parameter(EnsembleConfig& config, const std::string& name, double value) {
+    if (name == "learning_rate") config.learning_rate = value;
+    else if (name == "decay_rate") config.decay_rate = value;
+    else if (name == "initial_weight") config.initial_weight = value;
+    else if (name == "dt") config.dt = value;
+    else if (name == "sim_duration") config.sim_duration = value;
+    else return false;
+    return true;
+}
+
+namespace {
+
+// Reducer accumulating only the sum and sum of squares of final weights
+class FinalWeightMoments : public EnsembleObserver {
+public:
+    void record(size_t, double, const double*, const double*, const double*, int) override {}
+    void end_block(const BlockSummary& summary) override {
+        for (int l = 0; l < summary.active; ++l) {
+            sum += summary.weight[l];
+            sum_sq += summary.weight[l] * summary.weight[l];
+        }
+        count += summary.active;
+    }
+
+    double sum = 0, sum_sq = 0;
+    size_t count = 0;
+};
+
+} // namespace
+
+FinalWeightSummary summarize_final_weight(const EnsembleConfig& config, size_t first_replica) {
+    EnsembleConfig quiet = config;
+    quiet.record_every = ~static_cast<size_t>(0) >> 1; // only step 0 is offered to record()
+    Ensemble ensemble(quiet);
+    FinalWeightMoments moments;
+    ensemble.run_replicas(first_replica, config.replicas, moments);
+
+    FinalWeightSummary summary = {0.0, 0.0};
+    if (moments.count == 0) return summary;
+    summary.mean = moments.sum / moments.count;
+    if (moments.count > 1) {
+        double variance = (moments.sum_sq - moments.sum * summary.mean) / (moments.count - 1);
+        summary.variance = variance > 0 ? variance : 0.0;
+    }
+    return summary;
+}
+
+// --- FinalStateRecorder Class Implementation ---
+
+void FinalStateRecorder::end_block(const BlockSummary& summary) {
+    size_t needed = summary.first_replica + summary.active;
+    if (final_weight.size() < needed) {
+        final_weight.resize(needed);
+        pre_spikes.resize(needed);
+        post_spikes.resize(needed);
+        paired_spikes.resize(needed);
+    }
+    for (int l = 0; l < summary.active; ++l) {
+        size_t r = summary.first_replica + l;
+        final_weight[r] = summary.weight[l];
+        pre_spikes[r] = summary.pre_spikes[l];
+        post_spikes[r] = summary.post_spikes[l];
+        paired_spikes[r] = summary.paired_spikes[l];
+    }
+}
+
+void FinalStateRecorder::save(const std::string& filepath, double sim_duration) const {
+    std::ofstream outfile(filepath);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return;
+    }
+
+    outfile << "replica,final_weight,pre_rate,post_rate\n";
+    for (size_t r = 0; r < final_weight.size(); ++r) {
+        outfile << r << ","
+                << final_weight[r] << ","
+                << pre_spikes[r] / sim_duration << ","
+                << post_spikes[r] / sim_duration << "\n";
+    }
+}
+
+// --- TrajectoryRecorder Class Implementation ---
+
+TrajectoryRecorder::TrajectoryRecorder(const std::string& filepath) : outfile(filepath) {
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return;
+    }
+    outfile << "replica,time,pre_activity,post_activity,synaptic_weight\n";
+}
+
+void TrajectoryRecorder::begin_block(size_t first_replica, int) {
+    block_first = first_replica;
+}
+
+void TrajectoryRecorder::record(size_t, double time, const double* weight, const double* pre, const double* post, int active) {
+    if (!outfile.is_open()) return;
+    for (int l = 0; l < active; ++l) {
+        outfile << block_first + l << ","
+                << time << ","
+                << pre[l] << ","
+                << post[l] << ","
+                << weight[l] << "\n";
+    }
+}
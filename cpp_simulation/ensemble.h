@@ -0,0 +1,223 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Counter-based random stream. Every (key, counter) pair maps to an independent
+// uniform draw, so each replica lane owns a stream without carrying generator state.
+class CounterRng {
+public:
+    explicit CounterRng(uint64_t key) : key(key) {}
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    static double uniform(uint64_t key, uint64_t counter) {
+        uint64_t z = mix(key ^ (counter * 0x9E3779B97F4A7C15ULL));
+        z = mix(z + key);
+        return static_cast<double>(z >> 11) * 0x1.0p-53;
+    }
+
+    // Stream key for one replica of an ensemble seeded with `seed`
+    static uint64_t replica_key(uint64_t seed, uint64_t replica) {
+        return mix(seed ^ mix(replica + 1));
+    }
+
+    double uniform(uint64_t counter) const { return uniform(key, counter); }
+
+private:
+    uint64_t key;
+};
+
+// Randomized quasi-Monte Carlo draws: padded 1-D Sobol points with hash-based
+// Owen scrambling and per-dimension index shuffling (Burley 2020). Every uniform
+// draw of a step is its own dimension, so no direction-number table is needed.
+struct OwenSobol {
+    static uint32_t reverse_bits(uint32_t x) {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+        x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    static uint32_t laine_karras(uint32_t x, uint32_t seed) {
+        x += seed;
+        x ^= x * 0x6C50B47Cu;
+        x ^= x * 0xB82F1E52u;
+        x ^= x * 0xC7AFE638u;
+        x ^= x * 0x8D22F6E6u;
+        return x;
+    }
+
+    static uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed) {
+        return reverse_bits(laine_karras(reverse_bits(x), seed));
+    }
+
+    // Draw for point `index` in dimension `dim` of the randomization keyed by `key`
+    static double uniform(uint64_t key, uint64_t dim, uint32_t index) {
+        uint64_t h = CounterRng::mix(key ^ (dim * 0x9E3779B97F4A7C15ULL));
+        uint32_t shuffled = nested_uniform_scramble(index, static_cast<uint32_t>(h));
+        uint32_t x = nested_uniform_scramble(reverse_bits(shuffled), static_cast<uint32_t>(h >> 32));
+        return (static_cast<double>(x) + 0.5) * 0x1.0p-32;
+    }
+};
+
+// Uniform draws consumed per replica per time step (pre spike, paired post, spontaneous post)
+const int kDrawsPerStep = 3;
+
+// Same activity model as Simulation::run, written branch-free so it vectorizes across lanes
+inline void random_activity(double u_pre, double u_paired, double u_spont, double& pre_activity, double& post_activity) {
+    pre_activity = u_pre > 0.7 ? 1.0 : 0.0;
+    double paired = (pre_activity > 0.5 && u_paired > 0.3) ? 1.0 : 0.0;
+    double spont = u_spont > 0.9 ? 1.0 : 0.0;
+    post_activity = paired > spont ? paired : spont;
+}
+
+// Per-step rates of the activity model above, used as control-variate means
+const double kExpectedPreRate = 0.3;
+const double kExpectedPairedRate = 0.3 * (0.7 + 0.3 * 0.1); // P(pre) * P(post | pre)
+
+// How replica input streams are drawn
+enum class Sampling {
+    MonteCarlo,      // independent counter-based streams
+    Antithetic,      // replica pairs share a stream, the odd one uses 1 - u
+    QuasiMonteCarlo  // scrambled Sobol points, qmc_points per randomization
+};
+
+// Parameters shared by every replica of an ensemble
+struct EnsembleConfig {
+    double sim_duration;
+    double dt;
+    double learning_rate;
+    double decay_rate;
+    double initial_weight;
+    size_t replicas;
+    uint64_t seed;
+    size_t record_every = 1; // record every n-th step
+    int lanes = 8;           // replicas stepped together per block (4, 8 or 16)
+    Sampling sampling = Sampling::MonteCarlo;
+    size_t qmc_points = 256; // points per scrambled Sobol randomization (power of two)
+};
+
+// Per-block totals handed to observers once a block of replicas has finished
+struct BlockSummary {
+    size_t first_replica;
+    int active;                 // lanes carrying real replicas (the last block may be partial)
+    const double* weight;       // final weight per lane
+    const double* pre_spikes;   // pre-synaptic spike count per lane
+    const double* post_spikes;  // post-synaptic spike count per lane
+    const double* paired_spikes; // coincident pre*post count per lane
+};
+
+// Receives recorded samples for one block of replicas stepped together.
+// Pointers refer to lane arrays and are only valid for the duration of the call.
+class EnsembleObserver {
+public:
+    virtual ~EnsembleObserver() {}
+    virtual void begin_block(size_t first_replica, int active) { (void)first_replica; (void)active; }
+    virtual void record(size_t sample, double time, const double* weight, const double* pre, const double* post, int active) = 0;
+    virtual void end_block(const BlockSummary& summary) { (void)summary; }
+};
+
+// Runs independent stochastic replicas of the single-synapse model, packing
+// `lanes` replicas into structure-of-arrays blocks that are stepped together.
+class Ensemble {
+public:
+    explicit Ensemble(const EnsembleConfig& config);
+
+    void run(EnsembleObserver& observer) const;
+    // Runs replicas [first, first + count); lets callers launch an ensemble incrementally
+    void run_replicas(size_t first, size_t count, EnsembleObserver& observer) const;
+
+    size_t num_steps() const { return steps; }
+    size_t num_samples() const { return (steps + config.record_every - 1) / config.record_every; }
+    const EnsembleConfig& get_config() const { return config; }
+    // Consecutive replicas that together form one independent sample: 1 for plain
+    // Monte Carlo, 2 for antithetic pairs, qmc_points for one QMC randomization
+    size_t group_size() const;
+
+private:
+    template <int Lanes>
+    void run_lanes(size_t first_replica, int active, EnsembleObserver& observer) const;
+    template <int Lanes, Sampling Mode>
+    void run_block(size_t first_replica, int active, EnsembleObserver& observer) const;
+
+    EnsembleConfig config;
+    size_t steps;
+};
+
+// Overrides one model parameter by name (learning_rate, decay_rate, initial_weight,
+// dt or sim_duration); returns false for an unknown name.
+bool set_parameter(EnsembleConfig& config, const std::string& name, double value);
+bool is_parameter(const std::string& name);
+
+// Range a parameter is varied over by the sweep, sensitivity and calibration modes
+struct ParameterRange {
+    std::string name; // any name accepted by set_parameter
+    double low;
+    double high;
+};
+
+// Mean and variance of the final weight over replicas [first_replica, first_replica + config.replicas)
+struct FinalWeightSummary {
+    double mean;
+    double variance;
+};
+FinalWeightSummary summarize_final_weight(const EnsembleConfig& config, size_t first_replica = 0);
+
+// Forwards every callback to several observers so one pass over the replicas feeds them all
+class ObserverGroup : public EnsembleObserver {
+public:
+    void add(EnsembleObserver* observer) { observers.push_back(observer); }
+    void begin_block(size_t first_replica, int active) override {
+        for (auto* observer : observers) observer->begin_block(first_replica, active);
+    }
+    void record(size_t sample, double time, const double* weight, const double* pre, const double* post, int active) override {
+        for (auto* observer : observers) observer->record(sample, time, weight, pre, post, active);
+    }
+    void end_block(const BlockSummary& summary) override {
+        for (auto* observer : observers) observer->end_block(summary);
+    }
+
+private:
+    std::vector<EnsembleObserver*> observers;
+};
+
+// Reducer keeping only per-replica end-of-run state
+class FinalStateRecorder : public EnsembleObserver {
+public:
+    void record(size_t, double, const double*, const double*, const double*, int) override {}
+    void end_block(const BlockSummary& summary) override;
+    void save(const std::string& filepath, double sim_duration) const;
+
+    std::vector<double> final_weight;
+    std::vector<double> pre_spikes;
+    std::vector<double> post_spikes;
+    std::vector<double> paired_spikes;
+};
+
+// Recorder streaming every replica's recorded samples to a CSV file
+class TrajectoryRecorder : public EnsembleObserver {
+public:
+    explicit TrajectoryRecorder(const std::string& filepath);
+    bool is_open() const { return outfile.is_open(); }
+    void begin_block(size_t first_replica, int active) override;
+    void record(size_t sample, double time, const double* weight, const double* pre, const double* post, int active) override;
+
+private:
+    std::ofstream outfile;
+    size_t block_first = 0;
+};
+
+#endif // ENSEMBLE_H
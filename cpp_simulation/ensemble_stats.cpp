@@ -0,0 +1,216 @@
+#include "ensemble_stats.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+// --- OnlineStats Implementation ---
+
+void OnlineStats::merge(const OnlineStats& other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    double total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * count * other.count / total;
+    count = total;
+}
+
+double OnlineStats::ci_half_width(double z) const {
+    if (count < 2) return INFINITY;
+    return z * std::sqrt(variance() / count);
+}
+
+// --- EnsembleStatsObserver Class Implementation ---
+
+EnsembleStatsObserver::EnsembleStatsObserver(size_t num_samples, size_t group_size)
+    : group(group_size ? group_size : 1),
+      samples(num_samples),
+      block_samples(num_samples),
+      group_sum(num_samples, 0.0),
+      times(num_samples, 0.0) {}
+
+void EnsembleStatsObserver::begin_block(size_t first_replica, int) {
+    block_first = first_replica;
+    for (auto& stats : block_samples) stats = OnlineStats();
+}
+
+void EnsembleStatsObserver::record(size_t sample, double time, const double* weight, const double*, const double*, int active) {
+    if (sample >= block_samples.size()) return;
+    times[sample] = time;
+    OnlineStats& stats = block_samples[sample];
+    if (group == 1) {
+        for (int l = 0; l < active; ++l) {
+            stats.add(weight[l]);
+        }
+        return;
+    }
+    double& sum = group_sum[sample];
+    for (int l = 0; l < active; ++l) {
+        sum += weight[l];
+        if ((block_first + l + 1) % group == 0) {
+            stats.add(sum / group);
+            sum = 0;
+        }
+    }
+}
+
+void EnsembleStatsObserver::end_block(const BlockSummary& summary) {
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i].merge(block_samples[i]);
+    }
+    for (int l = 0; l < summary.active; ++l) {
+        final_group_sum += summary.weight[l];
+        if ((summary.first_replica + l + 1) % group == 0) {
+            final_weight.add(final_group_sum / group);
+            final_group_sum = 0;
+        }
+    }
+}
+
+double EnsembleStatsObserver::max_ci_half_width(double z) const {
+    double widest = final_weight.ci_half_width(z);
+    for (const auto& stats : samples) {
+        double half_width = stats.ci_half_width(z);
+        if (half_width > widest) widest = half_width;
+    }
+    return widest;
+}
+
+void EnsembleStatsObserver::save(const std::string& filepath, double z) const {
+    std::ofstream outfile(filepath);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return;
+    }
+
+    outfile << "time,replicas,mean_weight,std_weight,ci_low,ci_high\n";
+    size_t undefined = 0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const OnlineStats& stats = samples[i];
+        outfile << times[i] << "," << stats.count * group << "," << stats.mean << ",";
+        if (stats.count < 2) {
+            // No spread from one sample: leave the columns empty rather than writing inf
+            outfile << ",,\n";
+            ++undefined;
+            continue;
+        }
+        double half_width = stats.ci_half_width(z);
+        outfile << std::sqrt(stats.variance()) << ","
+                << stats.mean - half_width << ","
+                << stats.mean + half_width << "\n";
+    }
+    if (undefined > 0) {
+        std::cerr << "Warning: " << undefined << " time points in " << filepath
+                  << " have fewer than two samples; their spread and interval are left empty." << std::endl;
+    }
+}
+
+// --- ControlVariateEstimator Class Implementation ---
+
+ControlVariateEstimator::ControlVariateEstimator(size_t num_steps, size_t group_size, double expected_control)
+    : steps(num_steps ? static_cast<double>(num_steps) : 1.0),
+      group(group_size ? group_size : 1),
+      expected(expected_control) {}
+
+void ControlVariateEstimator::add(double y, double c) {
+    count += 1;
+    double dy = y - mean_y;
+    double dc = c - mean_c;
+    mean_y += dy / count;
+    mean_c += dc / count;
+    m2_y += dy * (y - mean_y);
+    m2_c += dc * (c - mean_c);
+    co_moment += dy * (c - mean_c);
+}
+
+void ControlVariateEstimator::end_block(const BlockSummary& summary) {
+    for (int l = 0; l < summary.active; ++l) {
+        group_y += summary.weight[l];
+        group_c += summary.paired_spikes[l] / steps;
+        if ((summary.first_replica + l + 1) % group == 0) {
+            add(group_y / group, group_c / group);
+            group_y = group_c = 0;
+        }
+    }
+}
+
+double ControlVariateEstimator::coefficient() const {
+    return m2_c > 0 ? co_moment / m2_c : 0.0;
+}
+
+double ControlVariateEstimator::estimate() const {
+    return mean_y - coefficient() * (mean_c - expected);
+}
+
+double ControlVariateEstimator::std_error() const {
+    if (count < 3) return INFINITY;
+    // Residual variance after regressing the output on the control (one extra dof for beta)
+    double residual = m2_y - coefficient() * co_moment;
+    if (residual < 0) residual = 0;
+    return std::sqrt(residual / (count - 2) / count);
+}
+
+double ControlVariateEstimator::naive_std_error() const {
+    if (count < 2) return INFINITY;
+    return std::sqrt(m2_y / (count - 1) / count);
+}
+
+void ControlVariateEstimator::save(const std::string& filepath) const {
+    std::ofstream outfile(filepath);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return;
+    }
+
+    // An undefined standard error (too few samples) is left empty
+    auto row = [&outfile, this](const char* name, double mean, double error) {
+        outfile << name << "," << count << "," << mean << ",";
+        if (std::isfinite(error)) outfile << error;
+        outfile << "\n";
+    };
+    outfile << "estimator,samples,mean_final_weight,std_error\n";
+    row("sample_mean", mean_y, naive_std_error());
+    row("control_variate", estimate(), std_error());
+}
+
+// --- Early Stopping ---
+
+size_t run_until_converged(const Ensemble& ensemble, EnsembleStatsObserver& observer, const StoppingRule& rule,
+                           EnsembleObserver* extra) {
+    // Batches cover whole lane blocks and whole sample groups
+    size_t unit = static_cast<size_t>(ensemble.get_config().lanes);
+    if (ensemble.group_size() > unit) unit = ensemble.group_size();
+    auto round_up = [unit](size_t n) { return (n + unit - 1) / unit * unit; };
+
+    ObserverGroup both;
+    both.add(&observer);
+    if (extra) both.add(extra);
+
+    size_t launched = 0;
+    size_t batch = round_up(rule.min_replicas > 2 * unit ? rule.min_replicas : 2 * unit);
+    while (launched < rule.max_replicas) {
+        if (launched + batch > rule.max_replicas) batch = rule.max_replicas - launched;
+        ensemble.run_replicas(launched, batch, both);
+        launched += batch;
+
+        double half_width = observer.max_ci_half_width(rule.z);
+        if (half_width <= rule.target_half_width) break;
+
+        // The half-width shrinks as 1/sqrt(n): project the replicas still needed and
+        // launch that many (at least one block, at most doubling) before checking again.
+        double ratio = half_width / rule.target_half_width;
+        size_t projected = static_cast<size_t>(std::ceil(launched * ratio * ratio));
+        size_t remaining = projected > launched ? projected - launched : unit;
+        if (remaining > launched) remaining = launched;
+        batch = round_up(remaining);
+    }
+    if (observer.final_weight.count == 0) {
+        std::cerr << "Error: Not one group of " << ensemble.group_size() << " replicas completed within "
+                  << rule.max_replicas << " replicas." << std::endl;
+        return 0;
+    }
+    return launched;
+}
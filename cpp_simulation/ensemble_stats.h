@@ -0,0 +1,106 @@
+#ifndef ENSEMBLE_STATS_H
+#define ENSEMBLE_STATS_H
+
+#include "ensemble.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Streaming mean/variance (Welford) that can merge partial results (Chan et al.)
+struct OnlineStats {
+    double count = 0;
+    double mean = 0;
+    double m2 = 0;
+
+    void add(double x) {
+        count += 1;
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+
+    void merge(const OnlineStats& other);
+    double variance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+    // Half-width of the normal-approximation confidence interval for the mean
+    double ci_half_width(double z) const;
+};
+
+// Reducer keeping mean weight trajectory statistics across replicas.
+// Each block is summarized over its lanes, then merged into the running totals.
+// Replicas are averaged in groups of `group_size` consecutive replicas first
+// (antithetic pairs, QMC point sets) so every statistic sees independent samples;
+// a trailing incomplete group is left out.
+class EnsembleStatsObserver : public EnsembleObserver {
+public:
+    explicit EnsembleStatsObserver(size_t num_samples, size_t group_size = 1);
+
+    void begin_block(size_t first_replica, int active) override;
+    void record(size_t sample, double time, const double* weight, const double* pre, const double* post, int active) override;
+    void end_block(const BlockSummary& summary) override;
+
+    size_t replicas() const { return static_cast<size_t>(final_weight.count) * group; }
+    // Widest confidence interval over all recorded time points
+    double max_ci_half_width(double z) const;
+    void save(const std::string& filepath, double z) const;
+
+    const std::vector<OnlineStats>& get_samples() const { return samples; }
+    const std::vector<double>& get_times() const { return times; }
+    OnlineStats final_weight;
+
+private:
+    size_t group;
+    size_t block_first = 0;
+    std::vector<OnlineStats> samples;
+    std::vector<OnlineStats> block_samples;
+    std::vector<double> group_sum;
+    std::vector<double> times;
+    double final_group_sum = 0;
+};
+
+// Control-variate estimate of the mean final weight. The control is each sample's
+// realized pre*post rate per step, whose expectation is known analytically, so the
+// part of the weight's spread explained by spike-count noise is subtracted out.
+class ControlVariateEstimator : public EnsembleObserver {
+public:
+    ControlVariateEstimator(size_t num_steps, size_t group_size = 1, double expected_control = kExpectedPairedRate);
+
+    void record(size_t, double, const double*, const double*, const double*, int) override {}
+    void end_block(const BlockSummary& summary) override;
+
+    double estimate() const;
+    double coefficient() const;
+    double std_error() const;
+    // The plain sample mean and its standard error, for comparison
+    double naive_mean() const { return mean_y; }
+    double naive_std_error() const;
+    size_t samples() const { return static_cast<size_t>(count); }
+    void save(const std::string& filepath) const;
+
+private:
+    void add(double y, double c);
+
+    double steps;
+    size_t group;
+    double expected;
+    double count = 0;
+    double mean_y = 0, mean_c = 0;
+    double m2_y = 0, m2_c = 0, co_moment = 0;
+    double group_y = 0, group_c = 0;
+};
+
+// Statistical early stopping: launch replicas until every recorded time point's
+// confidence interval is narrower than the target half-width.
+struct StoppingRule {
+    double target_half_width = 0;
+    double z = 1.96;          // 95% band
+    size_t min_replicas = 32;
+    size_t max_replicas = 100000;
+};
+
+// Returns the number of replicas run, or 0 (after reporting it) if not one whole
+// sample group fit within max_replicas; the observer holds the merged statistics
+// `extra`, when given, observes the same replicas (e.g. a ControlVariateEstimator).
+size_t run_until_converged(const Ensemble& ensemble, EnsembleStatsObserver& observer, const StoppingRule& rule,
+                           EnsembleObserver* extra = nullptr);
+
+#endif // ENSEMBLE_STATS_H
@@ -0,0 +1,187 @@
+#include "event_trace.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+const char kEventMagic[] = "# quanta_dorsa spike events v1";
+
+// Reads one "name,value" parameter line
+bool read_parameter(std::istream& in, const std::string& name, std::string& value) {
+    std::string line;
+    if (!std::getline(in, line)) return false;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.compare(0, name.size() + 1, name + ",") != 0) return false;
+    value = line.substr(name.size() + 1);
+    return true;
+}
+
+} // namespace
+
+// --- EventTrace Class Implementation ---
+
+EventTrace::EventTrace(double dt, double learning_rate, double decay_rate, double initial_weight, std::string region_name,
+                       std::pmr::memory_resource* resource)
+    : dt(dt),
+      learning_rate(learning_rate),
+      decay_rate(decay_rate),
+      initial_weight(initial_weight),
+      region(region_name),
+      events(resource),
+      changes(resource) {}
+
+bool EventTrace::record(const SimRows& rows) {
+    events.clear();
+    changes.clear();
+    steps = 0;
+
+    double weight = initial_weight;
+    double t = 0;
+    for (size_t k = 0; k < rows.size(); ++k) {
+        const SimData& row = rows[k];
+        const bool pre = row.pre_activity == 1.0, post = row.post_activity == 1.0;
+        if ((!pre && row.pre_activity != 0.0) || (!post && row.post_activity != 0.0)) {
+            std::cerr << "Error: Step " << k << " has non-binary activity; spike events need 0/1 spikes." << std::endl;
+            return false;
+        }
+        weight = hebbian_step(weight, row.pre_activity, row.post_activity, learning_rate, decay_rate, dt);
+        if (weight != row.synaptic_weight || t != row.time) {
+            std::cerr << "Error: Step " << k << " does not follow from the run parameters; "
+                      << "spike events need the unrounded trace of one run." << std::endl;
+            return false;
+        }
+        if (pre || post) {
+            if (pre && post) changes.push_back(events.size());
+            events.push_back({k, t, pre, post, weight});
+        }
+        t += dt;
+    }
+    steps = rows.size();
+    if (!rows.empty()) region = rows.front().region;
+    return true;
+}
+
+bool EventTrace::save(const std::string& filepath) const {
+    std::ofstream outfile(filepath);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return false;
+    }
+
+    outfile << std::setprecision(std::numeric_limits<double>::max_digits10);
+    outfile << kEventMagic << "\n"
+            << "region," << region << "\n"
+            << "dt," << dt << "\n"
+            << "learning_rate," << learning_rate << "\n"
+            << "decay_rate," << decay_rate << "\n"
+            << "initial_weight," << initial_weight << "\n"
+            << "steps," << steps << "\n"
+            << "step,time,type,weight\n";
+    for (const auto& event : events) {
+        outfile << event.step << "," << event.time << ",";
+        if (event.pre && event.post) {
+            outfile << "pair," << event.weight << "\n";
+        } else {
+            outfile << (event.pre ? "pre," : "post,") << "\n";
+        }
+    }
+    return static_cast<bool>(outfile);
+}
+
+bool EventTrace::load(const std::string& filepath) {
+    std::ifstream infile(filepath);
+    if (!infile.is_open()) {
+        std::cerr << "Error: Could not open event file " << filepath << std::endl;
+        return false;
+    }
+
+    std::string line, value;
+    std::getline(infile, line);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line != kEventMagic) {
+        std::cerr << "Error: " << filepath << " is not a spike event file." << std::endl;
+        return false;
+    }
+    events.clear();
+    changes.clear();
+    try {
+        if (!read_parameter(infile, "region", region)) throw std::invalid_argument("region");
+        if (!read_parameter(infile, "dt", value)) throw std::invalid_argument("dt");
+        dt = std::stod(value);
+        if (!read_parameter(infile, "learning_rate", value)) throw std::invalid_argument("learning_rate");
+        learning_rate = std::stod(value);
+        if (!read_parameter(infile, "decay_rate", value)) throw std::invalid_argument("decay_rate");
+        decay_rate = std::stod(value);
+        if (!read_parameter(infile, "initial_weight", value)) throw std::invalid_argument("initial_weight");
+        initial_weight = std::stod(value);
+        if (!read_parameter(infile, "steps", value)) throw std::invalid_argument("steps");
+        steps = static_cast<size_t>(std::stoull(value));
+        std::getline(infile, line);
+
+        while (std::getline(infile, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            std::stringstream fields(line);
+            std::string step, time, type, weight;
+            std::getline(fields, step, ',');
+            std::getline(fields, time, ',');
+            std::getline(fields, type, ',');
+            std::getline(fields, weight);
+            SpikeEvent event{static_cast<size_t>(std::stoull(step)), std::stod(time), type != "post", type != "pre", 0.0};
+            if (type != "pre" && type != "post" && type != "pair") throw std::invalid_argument(line);
+            if (type == "pair") {
+                event.weight = std::stod(weight);
+                changes.push_back(events.size());
+            }
+            if ((!events.empty() && event.step <= events.back().step) || event.step >= steps) {
+                throw std::invalid_argument(line);
+            }
+            events.push_back(event);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Malformed event file " << filepath << " near: " << e.what() << std::endl;
+        events.clear();
+        changes.clear();
+        steps = 0;
+        return false;
+    }
+    return true;
+}
+
+SimRows EventTrace::expand(size_t begin, size_t end) const {
+    SimRows rows(events.get_allocator().resource());
+    end = std::min(end, steps);
+    if (begin >= end) return rows;
+    rows.reserve(end - begin);
+
+    // Resume after the last weight change before `begin`: its weight and time are stored exactly
+    size_t k = 0, next = 0;
+    double weight = initial_weight;
+    double t = 0;
+    auto change = std::lower_bound(changes.begin(), changes.end(), begin,
+                                   [this](size_t index, size_t step) { return events[index].step < step; });
+    if (change != changes.begin()) {
+        const SpikeEvent& resume = events[*(change - 1)];
+        k = resume.step + 1;
+        next = *(change - 1) + 1;
+        weight = resume.weight;
+        t = resume.time + dt;
+    }
+
+    for (; k < end; ++k) {
+        double pre_activity = 0.0, post_activity = 0.0;
+        if (next < events.size() && events[next].step == k) {
+            pre_activity = events[next].pre ? 1.0 : 0.0;
+            post_activity = events[next].post ? 1.0 : 0.0;
+            ++next;
+        }
+        weight = hebbian_step(weight, pre_activity, post_activity, learning_rate, decay_rate, dt);
+        if (k >= begin) rows.push_back({t, pre_activity, post_activity, weight, region});
+        t += dt;
+    }
+    return rows;
+}
@@ -0,0 +1,70 @@
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include "synapse.h"
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Sparse form of a single-synapse run: only the steps where a neuron spiked,
+// plus the weight after each coincident (pre and post) spike, the only steps
+// where Hebbian learning adds to the decay. Every other row follows from the
+// run parameters, so the dense trace is rebuilt exactly (bit for bit) by
+// replaying hebbian_step and the run loop's `t += dt` from the nearest earlier
+// weight change. The file grows with spike count, not step count.
+//
+// File layout (CSV, doubles written with 17 significant digits):
+//   # quanta_dorsa spike events v1
+//   region,<name>
+//   dt,<dt>
+//   learning_rate,<eta>
+//   decay_rate,<alpha>
+//   initial_weight,<w0>
+//   steps,<number of dense rows>
+//   step,time,type,weight
+//   <step>,<time>,pre|post|pair,<weight after the step, pair rows only>
+
+struct SpikeEvent {
+    size_t step;
+    double time;
+    bool pre;
+    bool post;
+    double weight; // weight after the step; only meaningful when pre && post
+};
+
+class EventTrace {
+public:
+    EventTrace() {}
+    // Events, and rows expanded from them, are allocated from `resource`
+    EventTrace(double dt, double learning_rate, double decay_rate, double initial_weight, std::string region_name,
+               std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Keeps the spikes of a dense run made with this trace's parameters. Returns
+    // false if replaying them does not reproduce `rows` exactly (e.g. rows read
+    // back from a rounded CSV, or from a different model).
+    bool record(const SimRows& rows);
+
+    bool save(const std::string& filepath) const;
+    bool load(const std::string& filepath);
+
+    // Dense rows for steps [begin, end), rebuilt on demand from the nearest
+    // weight change before `begin`
+    SimRows expand(size_t begin, size_t end) const;
+    SimRows expand() const { return expand(0, steps); }
+
+    size_t num_steps() const { return steps; }
+    const std::pmr::vector<SpikeEvent>& get_events() const { return events; }
+
+private:
+    double dt = 0;
+    double learning_rate = 0;
+    double decay_rate = 0;
+    double initial_weight = 0;
+    std::string region;
+    size_t steps = 0;
+    std::pmr::vector<SpikeEvent> events;
+    std::pmr::vector<size_t> changes; // indices into `events` of the pair events
+};
+
+#endif // EVENT_TRACE_H
@@ -0,0 +1,245 @@
+#include "frame_renderer.h"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Color {
+    uint8_t r, g, b;
+};
+
+// matplotlib defaults used by plot_synapse.py
+const Color kBlack = {0, 0, 0};
+const Color kGrid = {176, 176, 176};
+const Color kCurve = {0, 0, 255};
+const Color kCursor = {255, 0, 0};
+const Color kActive = {255, 0, 0};
+const Color kIdle = {128, 128, 128};
+
+inline void set_pixel(FrameBuffer& frame, int x, int y, Color c) {
+    if (x < 0 || y < 0 || x >= frame.width || y >= frame.height) return;
+    uint8_t* p = &frame.rgb[(static_cast<size_t>(y) * frame.width + x) * 3];
+    p[0] = c.r;
+    p[1] = c.g;
+    p[2] = c.b;
+}
+
+// Bresenham line stamped with a square brush of `thickness` pixels
+void draw_line(FrameBuffer& frame, int x0, int y0, int x1, int y1, Color c, int thickness) {
+    int dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    while (true) {
+        for (int oy = 0; oy < thickness; ++oy) {
+            for (int ox = 0; ox < thickness; ++ox) set_pixel(frame, x0 + ox, y0 + oy, c);
+        }
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+void fill_ellipse(FrameBuffer& frame, int cx, int cy, int rx, int ry, Color c) {
+    if (rx <= 0 || ry <= 0) return;
+    for (int y = -ry; y <= ry; ++y) {
+        double span = rx * std::sqrt(1.0 - static_cast<double>(y) * y / (static_cast<double>(ry) * ry));
+        int half = static_cast<int>(span + 0.5);
+        for (int x = -half; x <= half; ++x) set_pixel(frame, cx + x, cy + y, c);
+    }
+}
+
+// Tick spacing of 1, 2 or 5 times a power of ten giving at most `max_ticks` intervals
+double nice_step(double range, int max_ticks) {
+    double raw = range / max_ticks;
+    double magnitude = std::pow(10.0, std::floor(std::log10(raw)));
+    for (double factor : {1.0, 2.0, 5.0, 10.0}) {
+        if (factor * magnitude >= raw) return factor * magnitude;
+    }
+    return 10.0 * magnitude;
+}
+
+} // namespace
+
+// --- ImageSequenceSink Class Implementation ---
+
+ImageSequenceSink::ImageSequenceSink(const std::string& directory, const std::string& format)
+    : directory(directory), png(format != "ppm") {
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+}
+
+bool ImageSequenceSink::write(size_t index, const FrameBuffer& frame) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%04zu.%s", index, png ? "png" : "ppm");
+    thread_local std::vector<uint8_t> encoded;
+    if (png) {
+        encode_png(frame, encoded);
+    } else {
+        encode_ppm(frame, encoded);
+    }
+    return write_file((fs::path(directory) / name).string(), encoded);
+}
+
+// --- FrameRenderer Class Implementation ---
+
+FrameRenderer::FrameRenderer(const SimRows& trajectory, int width, int height)
+    : trajectory(trajectory),
+      max_time(0.0),
+      plot_left(static_cast<int>(0.08 * width)),
+      plot_right(static_cast<int>(0.97 * width)),
+      plot_top(static_cast<int>(0.08 * height)),
+      plot_bottom(static_cast<int>(0.66 * height)),
+      panel_top(static_cast<int>(0.74 * height)),
+      panel_bottom(static_cast<int>(0.95 * height)),
+      background(width, height) {
+    for (const auto& row : trajectory) {
+        if (row.time > max_time) max_time = row.time;
+    }
+    if (max_time <= 0) max_time = 1.0;
+    draw_axes(background);
+
+    frames.reserve(trajectory.size());
+    for (size_t step = 0; step < trajectory.size(); ++step) {
+        const SimData& row = trajectory[step];
+        frames.push_back({step, row.time, row.pre_activity > 0, row.post_activity > 0});
+    }
+}
+
+void FrameRenderer::resample(double fps, double playback_speed) {
+    if (trajectory.empty() || fps <= 0 || playback_speed <= 0) return;
+
+    // Frame k covers simulated times (start + k * interval, start + (k + 1) * interval];
+    // the first sample belongs to frame 0
+    const double interval = playback_speed / fps;
+    const double start = trajectory.front().time;
+    const double span = trajectory.back().time - start;
+    size_t count = static_cast<size_t>(std::ceil(span / interval - 1e-9));
+    if (count == 0) count = 1;
+
+    frames.assign(count, FrameSample());
+    size_t step = 0;
+    for (size_t k = 0; k < count; ++k) {
+        FrameSample& frame = frames[k];
+        frame.time = start + (k + 1) * interval;
+        frame.pre_spike = frame.post_spike = false;
+        bool last_frame = k + 1 == count;
+        while (step < trajectory.size() && (last_frame || trajectory[step].time <= frame.time + 1e-12)) {
+            frame.pre_spike = frame.pre_spike || trajectory[step].pre_activity > 0;
+            frame.post_spike = frame.post_spike || trajectory[step].post_activity > 0;
+            ++step;
+        }
+        // An interval with no samples holds the curve where it was
+        frame.last_step = step > 0 ? step - 1 : 0;
+        if (frame.time > max_time) frame.time = max_time;
+    }
+}
+
+int FrameRenderer::x_pixel(double time) const {
+    return plot_left + static_cast<int>(std::lround(time / max_time * (plot_right - plot_left)));
+}
+
+int FrameRenderer::y_pixel(double weight) const {
+    // Weight axis spans [0, 1.1] like ax1.set_ylim(0, 1.1)
+    return plot_bottom - static_cast<int>(std::lround(weight / 1.1 * (plot_bottom - plot_top)));
+}
+
+void FrameRenderer::draw_axes(FrameBuffer& frame) const {
+    double x_step = nice_step(max_time, 8);
+    for (double t = 0; t <= max_time + 1e-9; t += x_step) {
+        draw_line(frame, x_pixel(t), plot_top, x_pixel(t), plot_bottom, kGrid, 1);
+    }
+    for (int i = 0; i <= 5; ++i) {
+        int y = y_pixel(0.2 * i);
+        draw_line(frame, plot_left, y, plot_right, y, kGrid, 1);
+    }
+    draw_line(frame, plot_left, plot_top, plot_right, plot_top, kBlack, 1);
+    draw_line(frame, plot_left, plot_bottom, plot_right, plot_bottom, kBlack, 1);
+    draw_line(frame, plot_left, plot_top, plot_left, plot_bottom, kBlack, 1);
+    draw_line(frame, plot_right, plot_top, plot_right, plot_bottom, kBlack, 1);
+}
+
+void FrameRenderer::draw_segment(FrameBuffer& canvas, size_t step) const {
+    const SimData& to = trajectory[step];
+    const SimData& from = step > 0 ? trajectory[step - 1] : to;
+    draw_line(canvas, x_pixel(from.time), y_pixel(from.synaptic_weight),
+              x_pixel(to.time), y_pixel(to.synaptic_weight), kCurve, 2);
+}
+
+void FrameRenderer::draw_overlay(FrameBuffer& frame, const FrameSample& sample) const {
+    // Dashed time cursor (axvline with linestyle '--')
+    int x = x_pixel(sample.time);
+    for (int y = plot_top; y <= plot_bottom; y += 8) {
+        int end = y + 5 < plot_bottom ? y + 5 : plot_bottom;
+        draw_line(frame, x, y, x, end, kCursor, 1);
+    }
+
+    // Activity panel: circles of radius 0.1 in axes units at (0.4, 0.5) and (0.6, 0.5)
+    int panel_width = plot_right - plot_left;
+    int panel_height = panel_bottom - panel_top;
+    int cy = panel_top + panel_height / 2;
+    int rx = static_cast<int>(0.1 * panel_width);
+    int ry = static_cast<int>(0.1 * panel_height);
+    fill_ellipse(frame, plot_left + static_cast<int>(0.4 * panel_width), cy, rx, ry, sample.pre_spike ? kActive : kIdle);
+    fill_ellipse(frame, plot_left + static_cast<int>(0.6 * panel_width), cy, rx, ry, sample.post_spike ? kActive : kIdle);
+    draw_line(frame, plot_left + static_cast<int>(0.45 * panel_width), cy,
+              plot_left + static_cast<int>(0.55 * panel_width), cy, kBlack, 1);
+}
+
+bool FrameRenderer::render(FrameSink& sink, ThreadPool& pool) const {
+    size_t n = frames.size();
+    size_t workers = pool.size() ? pool.size() : 1;
+    // Each worker takes a contiguous run of frames per wave and first catches its
+    // canvas up to the start of that run
+    const size_t per_task = 8;
+    const size_t wave = workers * per_task;
+    std::vector<FrameBuffer> canvases(workers, background);
+    std::vector<size_t> drawn(workers, 0); // curve segments already on each canvas
+    std::vector<FrameBuffer> buffers(sink.ordered() ? wave : workers, background);
+    std::atomic<bool> ok(true);
+    // Canvases were copied by this thread; move each to its pinned worker's node
+    for (size_t w = 0; w < workers && pool.worker_node(w) >= 0; ++w) {
+        bind_to_node(canvases[w].rgb.data(), canvases[w].rgb.size(), pool.worker_node(w));
+        if (!sink.ordered()) bind_to_node(buffers[w].rgb.data(), buffers[w].rgb.size(), pool.worker_node(w));
+    }
+
+    for (size_t first = 0; first < n && ok; first += wave) {
+        size_t count = first + wave < n ? wave : n - first;
+        pool.parallel_for(count, per_task, [&](size_t begin, size_t end, size_t worker) {
+            FrameBuffer& canvas = canvases[worker];
+            size_t& done = drawn[worker];
+            if (done > frames[first + begin].last_step + 1) {
+                canvas.rgb = background.rgb;
+                done = 0;
+            }
+            for (size_t i = begin; i < end; ++i) {
+                const FrameSample& sample = frames[first + i];
+                for (; done <= sample.last_step; ++done) draw_segment(canvas, done);
+                FrameBuffer& frame = sink.ordered() ? buffers[i] : buffers[worker];
+                frame.rgb = canvas.rgb;
+                draw_overlay(frame, sample);
+                if (!sink.ordered() && !sink.write(first + i, frame)) ok = false;
+            }
+        });
+        if (sink.ordered()) {
+            for (size_t i = 0; i < count && ok; ++i) {
+                if (!sink.write(first + i, buffers[i])) ok = false;
+            }
+        }
+    }
+
+    bool finished = sink.finish();
+    return ok && finished;
+}
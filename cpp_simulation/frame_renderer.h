@@ -0,0 +1,77 @@
+#ifndef FRAME_RENDERER_H
+#define FRAME_RENDERER_H
+
+#include "image_encoder.h"
+#include "synapse.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Destination for rendered frames. Unless ordered() is true, write() may be
+// called concurrently from several workers, each with a distinct frame index.
+class FrameSink {
+public:
+    virtual ~FrameSink() {}
+    virtual bool write(size_t index, const FrameBuffer& frame) = 0;
+    // Ordered sinks (video streams) get every frame in index order from one thread
+    virtual bool ordered() const { return false; }
+    // Called once after the last frame; returns false if anything failed
+    virtual bool finish() { return true; }
+};
+
+// Writes <directory>/frame_%04d.png (or .ppm), the layout plot_synapse.py produces
+class ImageSequenceSink : public FrameSink {
+public:
+    ImageSequenceSink(const std::string& directory, const std::string& format);
+    bool write(size_t index, const FrameBuffer& frame) override;
+
+private:
+    std::string directory;
+    bool png;
+};
+
+// One output frame: the weight curve is drawn through `last_step`, the cursor
+// sits at `time`, and the activity circles light up if the neuron spiked at any
+// step the frame covers, so no spike between two frames is lost.
+struct FrameSample {
+    size_t last_step;
+    double time;
+    bool pre_spike;
+    bool post_spike;
+};
+
+// Rasterizes the two-panel plot_synapse.py layout (weight curve with a time
+// cursor above, pre/post activity circles below), by default one frame per step.
+// The static axes are drawn once; each worker then extends its own copy of the
+// curve one segment per frame, so a run costs O(steps) drawing, not O(steps^2).
+// Frames are rendered in waves of consecutive indices, so an ordered sink only
+// ever buffers one wave.
+class FrameRenderer {
+public:
+    FrameRenderer(const SimRows& trajectory, int width = 1000, int height = 800);
+
+    size_t num_frames() const { return frames.size(); }
+    // Replaces the default one-frame-per-step schedule with `fps` frames per second
+    // of video, each covering `playback_speed` simulated seconds per second
+    void resample(double fps, double playback_speed);
+    // Renders every frame into `sink` on the pool's workers; false if a write failed
+    bool render(FrameSink& sink, ThreadPool& pool) const;
+
+private:
+    int x_pixel(double time) const;
+    int y_pixel(double weight) const;
+    void draw_axes(FrameBuffer& frame) const;
+    void draw_segment(FrameBuffer& canvas, size_t step) const;
+    void draw_overlay(FrameBuffer& frame, const FrameSample& sample) const;
+
+    const SimRows& trajectory;
+    std::vector<FrameSample> frames;
+    double max_time;
+    // Plot areas in pixels: weight axes and activity panel
+    int plot_left, plot_right, plot_top, plot_bottom;
+    int panel_top, panel_bottom;
+    FrameBuffer background;
+};
+
+#endif // FRAME_RENDERER_H
@@ -0,0 +1,200 @@
+#include "image_encoder.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+struct CrcTable {
+    uint32_t entry[256];
+    CrcTable() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entry[n] = c;
+        }
+    }
+};
+
+uint32_t crc32(const uint8_t* data, size_t length) {
+    static const CrcTable table; // initialized once, safely, by whichever thread gets here first
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) crc = table.entry[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+uint32_t adler32(const std::vector<uint8_t>& data) {
+    uint32_t a = 1, b = 0;
+    size_t i = 0;
+    while (i < data.size()) {
+        // 5552 bytes is the longest run before the sums can overflow 32 bits
+        size_t end = i + 5552 < data.size() ? i + 5552 : data.size();
+        for (; i < end; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 24));
+    out.push_back(static_cast<uint8_t>(v >> 16));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void put_chunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    put_u32(out, static_cast<uint32_t>(data.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_u32(out, crc32(&out[start], out.size() - start));
+}
+
+// Deflate bit stream: fields are packed LSB first
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    void bits(uint32_t value, int count) {
+        buffer |= static_cast<uint64_t>(value) << filled;
+        filled += count;
+        while (filled >= 8) {
+            out.push_back(static_cast<uint8_t>(buffer));
+            buffer >>= 8;
+            filled -= 8;
+        }
+    }
+
+    void flush() {
+        if (filled > 0) out.push_back(static_cast<uint8_t>(buffer));
+        buffer = 0;
+        filled = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t buffer = 0;
+    int filled = 0;
+};
+
+// Fixed Huffman literal/length codes (RFC 1951, 3.2.6), pre-reversed for the LSB-first stream
+struct FixedCodes {
+    uint32_t bits[288];
+    int length[288];
+    FixedCodes() {
+        for (int symbol = 0; symbol < 288; ++symbol) {
+            uint32_t code;
+            int n;
+            if (symbol < 144) code = 0x30 + symbol, n = 8;
+            else if (symbol < 256) code = 0x190 + symbol - 144, n = 9;
+            else if (symbol < 280) code = symbol - 256, n = 7;
+            else code = 0xC0 + symbol - 280, n = 8;
+            uint32_t reversed = 0;
+            for (int i = 0; i < n; ++i) reversed |= ((code >> i) & 1) << (n - 1 - i);
+            bits[symbol] = reversed;
+            length[symbol] = n;
+        }
+    }
+};
+
+inline void fixed_symbol(BitWriter& writer, int symbol) {
+    static const FixedCodes codes;
+    writer.bits(codes.bits[symbol], codes.length[symbol]);
+}
+
+// Match of `length` (3..258) bytes at distance 1, i.e. a run of the previous byte
+void run_match(BitWriter& writer, int length) {
+    static const int base[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                               35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    int code = 28;
+    while (base[code] > length) --code;
+    fixed_symbol(writer, 257 + code);
+    if (extra[code]) writer.bits(length - base[code], extra[code]);
+    writer.bits(0, 5); // distance code 0 = distance 1
+}
+
+// zlib stream of one fixed-Huffman block whose only matches are byte runs
+void deflate_runs(const std::vector<uint8_t>& data, std::vector<uint8_t>& out) {
+    out.push_back(0x78);
+    out.push_back(0x01);
+    BitWriter writer(out);
+    writer.bits(1, 1); // final block
+    writer.bits(1, 2); // fixed Huffman codes
+    size_t i = 0;
+    while (i < data.size()) {
+        fixed_symbol(writer, data[i]);
+        size_t run = 0;
+        while (i + 1 + run < data.size() && data[i + 1 + run] == data[i] && run < 258) ++run;
+        if (run >= 3) {
+            run_match(writer, static_cast<int>(run));
+            i += 1 + run;
+        } else {
+            ++i;
+        }
+    }
+    fixed_symbol(writer, 256);
+    writer.flush();
+    put_u32(out, adler32(data));
+}
+
+} // namespace
+
+void encode_png(const FrameBuffer& frame, std::vector<uint8_t>& out) {
+    static const uint8_t signature[] = {137, 80, 78, 71, 13, 10, 26, 10};
+    out.assign(signature, signature + 8);
+
+    std::vector<uint8_t> header;
+    put_u32(header, static_cast<uint32_t>(frame.width));
+    put_u32(header, static_cast<uint32_t>(frame.height));
+    header.push_back(8); // bit depth
+    header.push_back(2); // truecolor
+    header.push_back(0); // deflate
+    header.push_back(0); // adaptive filtering
+    header.push_back(0); // no interlace
+    put_chunk(out, "IHDR", header);
+
+    // Up filter: rows equal to the one above become zero runs
+    size_t stride = static_cast<size_t>(frame.width) * 3;
+    thread_local std::vector<uint8_t> filtered;
+    filtered.resize((stride + 1) * frame.height);
+    for (int y = 0; y < frame.height; ++y) {
+        const uint8_t* row = &frame.rgb[y * stride];
+        uint8_t* dst = &filtered[y * (stride + 1)];
+        if (y == 0) {
+            dst[0] = 0;
+            std::memcpy(dst + 1, row, stride);
+            continue;
+        }
+        dst[0] = 2;
+        for (size_t x = 0; x < stride; ++x) dst[x + 1] = static_cast<uint8_t>(row[x] - row[x - stride]);
+    }
+    thread_local std::vector<uint8_t> compressed;
+    compressed.clear();
+    deflate_runs(filtered, compressed);
+    put_chunk(out, "IDAT", compressed);
+    put_chunk(out, "IEND", std::vector<uint8_t>());
+}
+
+void encode_ppm(const FrameBuffer& frame, std::vector<uint8_t>& out) {
+    char header[64];
+    int length = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", frame.width, frame.height);
+    out.assign(header, header + length);
+    out.insert(out.end(), frame.rgb.begin(), frame.rgb.end());
+}
+
+bool write_file(const std::string& filepath, const std::vector<uint8_t>& bytes) {
+    std::ofstream outfile(filepath, std::ios::binary);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return false;
+    }
+    outfile.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(outfile);
+}
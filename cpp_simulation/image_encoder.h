@@ -0,0 +1,27 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 8-bit RGB image, rows top to bottom, 3 bytes per pixel
+struct FrameBuffer {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgb;
+
+    FrameBuffer() {}
+    FrameBuffer(int width, int height) : width(width), height(height), rgb(static_cast<size_t>(width) * height * 3, 255) {}
+};
+
+// Self-contained PNG encoder (no zlib): rows use the Up filter and the deflate
+// stream uses fixed Huffman codes with run-length matches. Plot frames are mostly
+// flat color, so this compresses them well at a fraction of zlib's encode cost.
+void encode_png(const FrameBuffer& frame, std::vector<uint8_t>& out);
+// Binary PPM (P6): a header followed by the raw pixels
+void encode_ppm(const FrameBuffer& frame, std::vector<uint8_t>& out);
+
+bool write_file(const std::string& filepath, const std::vector<uint8_t>& bytes);
+
+#endif // IMAGE_ENCODER_H
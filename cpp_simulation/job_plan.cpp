@@ -0,0 +1,479 @@
+#include "job_plan.h"
+#include "column_codec.h"
+#include "ensemble.h"
+#include "ensemble_stats.h"
+#include "event_trace.h"
+#include "frame_renderer.h"
+#include "image_encoder.h"
+#include "lod_pyramid.h"
+#include "protocol.h"
+#include "sensitivity.h"
+#include "spike_train.h"
+#include "thread_pool.h"
+#include "video_sink.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Measured output sizes of the default model (100k steps, region "hippocampus")
+const double kCsvRowBytes = 20;          // plus the region name
+const double kEventRowBytes = 39;        // one spike_events row
+const double kRandomEventFraction = 0.37; // steps with a pre or post spike under RandomActivity
+const double kPngFrameBytes = 31000;     // one 1000x800 frame
+const double kVideoFrameBytes = 5000;    // one H.264 frame at ffmpeg's defaults, roughly
+const double kDecimateRowNs = 5;         // one LTTB pass over a row held in memory, roughly
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Reads a key with a default, as synapse_sim does
+double number(const Config& config, const std::string& key, double fallback) {
+    return config.has(key) ? config.get_double(key) : fallback;
+}
+
+bool flag(const Config& config, const std::string& key) {
+    return config.has(key) && config.get_int(key) != 0;
+}
+
+// Step count of the run loop; the exact float loop would take as long as the run itself for huge jobs
+size_t plan_steps(double duration, double dt) {
+    if (!(dt > 0) || !(duration > 0)) return 0;
+    double estimate = std::ceil(duration / dt);
+    return estimate <= 1e8 ? count_steps(duration, dt) : static_cast<size_t>(estimate);
+}
+
+// std::vector growth by doubling: the capacity reached, and the old plus new
+// buffers alive during the last reallocation
+uint64_t vector_peak(uint64_t elements, uint64_t element_bytes) {
+    uint64_t capacity = 1;
+    while (capacity < elements) capacity *= 2;
+    return elements == 0 ? 0 : (capacity + capacity / 2) * element_bytes;
+}
+
+size_t count_data_lines(const std::string& filepath) {
+    std::ifstream file(filepath);
+    size_t lines = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty()) ++lines;
+    }
+    return lines > 0 ? lines - 1 : 0;
+}
+
+size_t count_parameter_ranges(const Config& config) {
+    size_t ranges = 0;
+    for (const auto& entry : config.entries()) {
+        const std::string& key = entry.first;
+        if (key.size() > 4 && key.compare(key.size() - 4, 4, "_min") == 0 && is_parameter(key.substr(0, key.size() - 4))) {
+            ++ranges;
+        }
+    }
+    return ranges;
+}
+
+// Frames and the render memory of render_frames / render_video for one region
+void plan_rendering(const Config& config, JobPlan& plan, const KernelCosts& costs, double duration) {
+    const bool frames = flag(config, "render_frames");
+    const bool video = flag(config, "render_video");
+    if (!frames && !video) return;
+
+    const double width = number(config, "frame_width", 1000), height = number(config, "frame_height", 800);
+    const double fps = number(config, "video_fps", 30);
+    double count = static_cast<double>(plan.steps);
+    if (config.has("video_seconds")) count = std::ceil(fps * config.get_double("video_seconds"));
+    else if (config.has("playback_speed")) count = std::ceil(fps * duration / config.get_double("playback_speed"));
+    const uint64_t frame_bytes = static_cast<uint64_t>(width * height * 3);
+    const double scale = width * height / (1000.0 * 800.0);
+
+    // The trajectory is read back from the CSV; each worker keeps a canvas and a frame
+    plan.memory.push_back({"render: trajectory", vector_peak(plan.steps, sizeof(SimData))});
+    plan.memory.push_back({"render: worker canvases", 2 * plan.threads * frame_bytes});
+    const std::string frames_dir = config.has("frames_dir") ? config.get_string("frames_dir") : "../frames";
+    if (frames) {
+        // Uncompressed PPM frames are the raw pixels plus a short header
+        const bool ppm = config.has("frame_format") && config.get_string("frame_format") == "ppm";
+        plan.outputs.push_back({frames_dir + "/" + plan.region + (ppm ? "/frame_*.ppm" : "/frame_*.png"),
+                                static_cast<uint64_t>(count * (ppm ? frame_bytes + 16 : kPngFrameBytes * scale))});
+        plan.runtime.push_back({"render frames", count * costs.frame * scale / plan.threads * 1e-9});
+    }
+    if (video) {
+        // Ordered sinks buffer one wave of frames (8 per worker)
+        plan.memory.push_back({"render: video wave", 8 * plan.threads * frame_bytes});
+        const std::string video_dir = config.has("video_dir") ? config.get_string("video_dir") : "../videos";
+        // "auto" falls back to raw Y4M (4:2:0, so 1.5 bytes per pixel) without ffmpeg
+        const std::string encoder = config.has("video_encoder") ? config.get_string("video_encoder") : "auto";
+        const bool y4m = encoder == "y4m" || (encoder == "auto" && !FfmpegSink::available());
+        plan.outputs.push_back({video_dir + "/" + plan.region + (y4m ? "_simulation.y4m" : "_simulation.mp4"),
+                                static_cast<uint64_t>(count * (y4m ? frame_bytes / 2 + 6 : kVideoFrameBytes * scale))});
+        plan.runtime.push_back({"render video", count * costs.frame * scale / plan.threads * 1e-9});
+    }
+}
+
+void plan_single(const Config& config, JobPlan& plan, const KernelCosts& costs) {
+    const double steps = static_cast<double>(plan.steps);
+    const std::string data = "../data/synapse_data_" + plan.region;
+    plan.synapses = 1;
+
+    uint64_t region_heap = plan.region.size() > 15 ? plan.region.size() + 1 : 0; // beyond the small-string buffer
+    plan.memory.push_back({"results", plan.steps * (sizeof(SimData) + region_heap)});
+    if (config.has("live_stream")) {
+        plan.memory.push_back({"live stream (shared)", 64 + 40 * static_cast<uint64_t>(number(config, "live_stream_capacity", 65536))});
+    }
+
+    // Fraction of steps with a spike, for the event output
+    double event_fraction = synthetic_event_fraction(config);
+    if (config.has("spike_input")) {
+        MappedSpikeTrain recorded(config.get_string("spike_input"));
+        if (recorded.is_open()) {
+            event_fraction = std::min(1.0, (recorded.num_spikes(0) + recorded.num_spikes(1)) / std::max(steps, 1.0));
+            // Both channel cursors keep a prefetch window and a release chunk mapped
+            uint64_t window = std::min<uint64_t>(fs::file_size(config.get_string("spike_input")), 2 * (5u << 20));
+            plan.memory.push_back({"spike input (mapped)", window});
+        }
+    } else if (config.has("protocol")) {
+        std::vector<StimulusEvent> schedule;
+        if (compile_protocol(config.get_string("protocol"), schedule)) {
+            event_fraction = std::min(1.0, schedule.size() / std::max(steps, 1.0));
+            plan.memory.push_back({"protocol schedule", vector_peak(schedule.size(), sizeof(StimulusEvent))});
+        }
+    }
+    plan.arena_bytes = single_arena_bytes(config, plan.steps, event_fraction);
+
+    const double row_bytes = kCsvRowBytes + plan.region.size();
+    plan.outputs.push_back({data + ".csv", static_cast<uint64_t>(steps * row_bytes)});
+    plan.runtime.push_back({"simulate", steps * costs.single_step * 1e-9});
+    plan.runtime.push_back({"write csv", steps * costs.csv_row * 1e-9});
+
+    if (config.has("decimate_points")) {
+        double points = std::min(steps, number(config, "decimate_points", 2000));
+        // Decimated from the rows in memory; only the kept rows are copied
+        plan.memory.push_back({"decimation", vector_peak(static_cast<uint64_t>(points), sizeof(SimData))});
+        plan.outputs.push_back({data + "_decimated.csv", static_cast<uint64_t>(points * row_bytes)});
+        plan.runtime.push_back({"decimate", steps * kDecimateRowNs * 1e-9 + points * costs.csv_row * 1e-9});
+    }
+    if (flag(config, "compress_output")) {
+        // Per row: about 1 bit of time, 2 of activity, and the kept weight mantissa plus XOR framing
+        double bits = number(config, "compress_weight_bits", 52) + 5;
+        plan.outputs.push_back({data + ".qdc", static_cast<uint64_t>(steps * bits / 8)});
+        plan.runtime.push_back({"compress", steps * costs.compress_row * 1e-9});
+    }
+    if (flag(config, "event_output")) {
+        plan.outputs.push_back({"../data/synapse_events_" + plan.region + ".csv",
+                                static_cast<uint64_t>(steps * event_fraction * kEventRowBytes)});
+        plan.memory.push_back({"event buffers", plan.arena_bytes - plan.steps * sizeof(SimData)});
+    }
+    if (flag(config, "lod_pyramid")) {
+        // Level L holds steps / 2^L buckets from kLodFirstLevel up; each level
+        // keeps one batch of buckets in memory until it is written
+        uint64_t bytes = 64, levels = 0;
+        for (uint64_t buckets = plan.steps; levels == 0 || buckets > 1; ++levels) {
+            buckets = (plan.steps + (uint64_t(1) << (kLodFirstLevel + levels)) - 1) >> (kLodFirstLevel + levels);
+            bytes += 16 + buckets * sizeof(LodBucket);
+        }
+        plan.memory.push_back({"lod pyramid", levels * kLodBatchBuckets * sizeof(LodBucket)});
+        plan.outputs.push_back({"../data/synapse_lod_" + plan.region + ".bin", bytes});
+    }
+    plan_rendering(config, plan, costs, config.get_double("sim_duration"));
+}
+
+void plan_ensemble(const Config& config, JobPlan& plan, const KernelCosts& costs) {
+    const double replicas = number(config, "ensemble_replicas", 1);
+    const double record_every = number(config, "record_every", 1);
+    const double samples = std::ceil(plan.steps / record_every);
+    const std::string output = config.has("ensemble_output") ? config.get_string("ensemble_output") : "final";
+    plan.synapses = static_cast<size_t>(replicas);
+    plan.threads = 1; // the ensemble engine runs its blocks on the calling thread
+
+    plan.runtime.push_back({"simulate", replicas * plan.steps * costs.lane_step * 1e-9});
+    if (output == "stats" || config.has("ensemble_ci_half_width")) {
+        // Running and per-block statistics plus times per recorded sample
+        plan.memory.push_back({"trajectory statistics", static_cast<uint64_t>(samples * (2 * sizeof(OnlineStats) + 16))});
+        plan.outputs.push_back({"../data/ensemble_stats_" + plan.region + ".csv", static_cast<uint64_t>(samples * 60)});
+    } else if (output == "trajectories") {
+        double rows = replicas * samples;
+        plan.outputs.push_back({"../data/ensemble_trajectories_" + plan.region + ".csv", static_cast<uint64_t>(rows * 30)});
+        plan.runtime.push_back({"write csv", rows * costs.csv_row * 1e-9});
+    } else {
+        plan.memory.push_back({"final states", static_cast<uint64_t>(4 * replicas * sizeof(double))});
+        plan.outputs.push_back({"../data/ensemble_" + plan.region + ".csv", static_cast<uint64_t>(replicas * 40)});
+    }
+    if (flag(config, "ensemble_control_variate")) {
+        plan.outputs.push_back({"../data/ensemble_cv_" + plan.region + ".csv", 200});
+    }
+}
+
+void plan_analysis(const Config& config, JobPlan& plan, const KernelCosts& costs) {
+    const double steps = static_cast<double>(plan.steps);
+    const double d = static_cast<double>(count_parameter_ranges(config));
+    if (plan.mode == "sensitivity") {
+        double replicas = number(config, "ensemble_replicas", 1);
+        plan.synapses = static_cast<size_t>(replicas);
+        plan.threads = 1;
+        plan.runtime.push_back({"dual-number pass", replicas * steps * costs.dual_step * 1e-9});
+        plan.outputs.push_back({"../data/sensitivity_" + plan.region + ".csv", 300});
+    } else if (plan.mode == "sobol") {
+        // Saltelli design: N rows for each of the d + 2 matrices
+        double runs = number(config, "sobol_samples", 1024) * (d + 2);
+        double replicas = runs * number(config, "sobol_replicas", 8);
+        plan.synapses = static_cast<size_t>(replicas);
+        plan.memory.push_back({"sobol runs", static_cast<uint64_t>(runs * (d + 2) * sizeof(double))});
+        plan.runtime.push_back({"simulate", replicas * steps * costs.lane_step / plan.threads * 1e-9});
+        plan.outputs.push_back({"../data/sobol_indices_" + plan.region + ".csv", static_cast<uint64_t>(d * 80)});
+        plan.outputs.push_back({"../data/sobol_runs_" + plan.region + ".csv", static_cast<uint64_t>(runs * (d + 2) * 12)});
+    } else if (plan.mode == "calibrate") {
+        // The replica budget bounds the search; convergence can stop it earlier
+        double replicas = number(config, "calibration_max_runs", 200000);
+        plan.synapses = static_cast<size_t>(replicas);
+        plan.runtime.push_back({"simulate (budget)", replicas * steps * costs.lane_step / plan.threads * 1e-9});
+        if (config.has("calibration_max_seconds")) {
+            plan.runtime.back().second = std::min(plan.runtime.back().second, config.get_double("calibration_max_seconds"));
+        }
+        plan.outputs.push_back({"../data/calibration_" + plan.region + ".csv", 2000});
+    } else if (plan.mode == "surrogate") {
+        // Every query may fall back to a simulation when the model is unsure
+        const std::string queries_file = config.has("surrogate_query_file") ? config.get_string("surrogate_query_file")
+                                                                             : "../data/surrogate_queries_" + plan.region + ".csv";
+        double queries = static_cast<double>(count_data_lines(queries_file));
+        double replicas = queries * number(config, "surrogate_replicas", 8);
+        double features = number(config, "surrogate_features", 256);
+        plan.synapses = static_cast<size_t>(replicas);
+        plan.threads = 1;
+        plan.memory.push_back({"surrogate model", static_cast<uint64_t>(features * features * sizeof(double) * 2)});
+        plan.runtime.push_back({"simulate (worst case)", replicas * steps * costs.lane_step * 1e-9});
+        plan.outputs.push_back({"../data/surrogate_" + plan.region + ".csv", static_cast<uint64_t>(queries * 60)});
+    }
+}
+
+std::string json_escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+std::string human_bytes(uint64_t bytes) {
+    const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = static_cast<double>(bytes);
+    int unit = 0;
+    while (value >= 1024 && unit < 4) {
+        value /= 1024;
+        ++unit;
+    }
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << value << " " << units[unit];
+    return text.str();
+}
+
+// Writes frames nowhere, so the benchmark times rendering and PNG encoding only
+class DiscardSink : public FrameSink {
+public:
+    bool write(size_t, const FrameBuffer& frame) override {
+        std::vector<uint8_t> png;
+        encode_png(frame, png);
+        bytes += png.size();
+        return true;
+    }
+    size_t bytes = 0;
+};
+
+} // namespace
+
+// --- KernelCosts Implementation ---
+
+bool KernelCosts::load(const std::string& filepath) {
+    std::ifstream infile(filepath);
+    if (!infile.is_open()) return false;
+    std::string line;
+    while (std::getline(infile, line)) {
+        std::string::size_type comma = line.find(',');
+        if (comma == std::string::npos) continue;
+        const std::string kernel = line.substr(0, comma);
+        double value = 0;
+        try {
+            value = std::stod(line.substr(comma + 1));
+        } catch (const std::exception&) {
+            continue;
+        }
+        if (kernel == "single_step") single_step = value;
+        else if (kernel == "csv_row") csv_row = value;
+        else if (kernel == "lane_step") lane_step = value;
+        else if (kernel == "dual_step") dual_step = value;
+        else if (kernel == "frame") frame = value;
+        else if (kernel == "compress_row") compress_row = value;
+    }
+    calibrated = true;
+    return true;
+}
+
+bool KernelCosts::save(const std::string& filepath) const {
+    std::ofstream outfile(filepath);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return false;
+    }
+    outfile << "kernel,nanoseconds\n"
+            << "single_step," << single_step << "\n"
+            << "csv_row," << csv_row << "\n"
+            << "lane_step," << lane_step << "\n"
+            << "dual_step," << dual_step << "\n"
+            << "frame," << frame << "\n"
+            << "compress_row," << compress_row << "\n";
+    return static_cast<bool>(outfile);
+}
+
+KernelCosts measure_kernel_costs() {
+    KernelCosts costs;
+    const fs::path scratch = fs::temp_directory_path() / ("qd_benchmark_" + std::to_string(::getpid()));
+
+    // Single-synapse step loop and its CSV
+    Simulation sim(2000.0, 0.01, 0.5, 0.1, 0.5, "benchmark");
+    sim.set_seed(1);
+    auto start = std::chrono::steady_clock::now();
+    sim.run();
+    const double steps = static_cast<double>(sim.get_results().size());
+    costs.single_step = seconds_since(start) * 1e9 / steps;
+
+    start = std::chrono::steady_clock::now();
+    write_results(scratch.string() + ".csv", sim.get_results());
+    costs.csv_row = seconds_since(start) * 1e9 / steps;
+
+    start = std::chrono::steady_clock::now();
+    save_compressed(scratch.string() + ".qdc", sim.get_results());
+    costs.compress_row = seconds_since(start) * 1e9 / steps;
+    fs::remove(scratch.string() + ".csv");
+    fs::remove(scratch.string() + ".qdc");
+
+    // Ensemble engine and the dual-number pass, on one thread
+    EnsembleConfig ens;
+    ens.sim_duration = 100.0;
+    ens.dt = 0.01;
+    ens.learning_rate = 0.5;
+    ens.decay_rate = 0.1;
+    ens.initial_weight = 0.5;
+    ens.replicas = 256;
+    ens.seed = 1;
+    Ensemble ensemble(ens);
+    FinalStateRecorder recorder;
+    start = std::chrono::steady_clock::now();
+    ensemble.run(recorder);
+    costs.lane_step = seconds_since(start) * 1e9 / (ens.replicas * ensemble.num_steps());
+
+    ens.replicas = 16;
+    start = std::chrono::steady_clock::now();
+    run_sensitivities(ens);
+    costs.dual_step = seconds_since(start) * 1e9 / (ens.replicas * ensemble.num_steps());
+
+    // Rendering plus PNG encoding, one worker
+    SimRows trajectory(sim.get_results().begin(), sim.get_results().begin() + 64);
+    FrameRenderer renderer(trajectory);
+    ThreadPool pool(1);
+    DiscardSink sink;
+    start = std::chrono::steady_clock::now();
+    renderer.render(sink, pool);
+    costs.frame = seconds_since(start) * 1e9 / renderer.num_frames();
+
+    costs.calibrated = true;
+    return costs;
+}
+
+// --- JobPlan Implementation ---
+
+uint64_t JobPlan::peak_memory() const {
+    // The run and the rendering after it are separate phases; the larger one is the peak
+    uint64_t run = 0, render = 0;
+    for (const auto& entry : memory) {
+        (entry.first.compare(0, 7, "render:") == 0 ? render : run) += entry.second;
+    }
+    return std::max(run, render);
+}
+
+uint64_t JobPlan::output_bytes() const {
+    uint64_t total = 0;
+    for (const auto& entry : outputs) total += entry.second;
+    return total;
+}
+
+double JobPlan::seconds() const {
+    double total = 0;
+    for (const auto& entry : runtime) total += entry.second;
+    return total;
+}
+
+double synthetic_event_fraction(const Config& config) {
+    if (!config.has("spike_correlation")) return kRandomEventFraction;
+    const double dt = config.get_double("dt");
+    double pre = 1 - std::exp(-number(config, "pre_rate", 30) * dt);
+    double post = 1 - std::exp(-number(config, "post_rate", 30) * dt);
+    return 1 - (1 - pre) * (1 - post);
+}
+
+uint64_t single_arena_bytes(const Config& config, size_t steps, double event_fraction) {
+    // Simulation::run reserves every row up front
+    uint64_t bytes = static_cast<uint64_t>(steps) * sizeof(SimData);
+    if (flag(config, "event_output")) {
+        // Pooled event and pair-index buffers, which grow by doubling
+        bytes += static_cast<uint64_t>(2 * static_cast<double>(steps) * event_fraction * (sizeof(SpikeEvent) + sizeof(size_t)));
+    }
+    return bytes;
+}
+
+JobPlan plan_job(const Config& config, const KernelCosts& costs) {
+    JobPlan plan;
+    plan.region = config.get_string("region");
+    plan.mode = config.has("mode") ? config.get_string("mode") : "single";
+    plan.steps = plan_steps(config.get_double("sim_duration"), config.get_double("dt"));
+    size_t threads = config.has("threads") ? static_cast<size_t>(config.get_int("threads")) : 0;
+    plan.threads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+
+    if (plan.mode == "single") plan_single(config, plan, costs);
+    else if (plan.mode == "ensemble") plan_ensemble(config, plan, costs);
+    else plan_analysis(config, plan, costs);
+    return plan;
+}
+
+void print_plan(std::ostream& out, const JobPlan& plan, bool json) {
+    if (json) {
+        auto list = [&out](const char* name, const auto& entries) {
+            out << ", \"" << name << "\": {";
+            for (size_t i = 0; i < entries.size(); ++i) {
+                out << (i ? ", " : "") << "\"" << json_escape(entries[i].first) << "\": " << entries[i].second;
+            }
+            out << "}";
+        };
+        out << "{\"region\": \"" << json_escape(plan.region) << "\", \"mode\": \"" << plan.mode << "\", \"steps\": "
+            << plan.steps << ", \"synapses\": " << plan.synapses << ", \"threads\": " << plan.threads
+            << ", \"peak_memory_bytes\": " << plan.peak_memory() << ", \"output_bytes\": " << plan.output_bytes()
+            << ", \"seconds\": " << plan.seconds();
+        list("memory", plan.memory);
+        list("outputs", plan.outputs);
+        list("runtime", plan.runtime);
+        out << "}\n";
+        return;
+    }
+
+    out << "Plan for region '" << plan.region << "' (" << plan.mode << " mode)\n"
+        << "  steps:    " << plan.steps << " per synapse, " << plan.synapses << " synapse(s), " << plan.threads
+        << " thread(s)\n"
+        << "  memory:   " << human_bytes(plan.peak_memory()) << " peak\n";
+    for (const auto& entry : plan.memory) out << "    " << std::left << std::setw(28) << entry.first << human_bytes(entry.second) << "\n";
+    out << "  outputs:  " << human_bytes(plan.output_bytes()) << "\n";
+    for (const auto& entry : plan.outputs) out << "    " << std::left << std::setw(48) << entry.first << human_bytes(entry.second) << "\n";
+    out << "  runtime:  " << std::fixed << std::setprecision(2) << plan.seconds() << " s\n";
+    for (const auto& entry : plan.runtime) out << "    " << std::left << std::setw(28) << entry.first << entry.second << " s\n";
+    out.unsetf(std::ios::fixed);
+    out << std::setprecision(6);
+}
@@ -0,0 +1,65 @@
+#ifndef JOB_PLAN_H
+#define JOB_PLAN_H
+
+#include "synapse.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Measured cost of each kernel a run is made of, in nanoseconds per unit of
+// work on one thread. `--benchmark` measures them on the current machine and
+// saves them; the planner falls back to conservative defaults otherwise.
+struct KernelCosts {
+    double single_step = 60;       // one step of Simulation::run, including recording it
+    double csv_row = 250;          // one row of a trajectory CSV
+    double lane_step = 4;          // one replica-step of the ensemble engine
+    double dual_step = 40;         // one replica-step of the sensitivity (dual-number) pass
+    double frame = 8e6;            // rendering and PNG-encoding one 1000x800 frame
+    double compress_row = 40;      // one row of the compressed column format
+    bool calibrated = false;
+
+    // "kernel,nanoseconds" lines; unknown kernels are ignored
+    bool load(const std::string& filepath);
+    bool save(const std::string& filepath) const;
+};
+
+// Times every kernel with small representative runs (a few seconds in total)
+KernelCosts measure_kernel_costs();
+
+// Predicted footprint of one run, as a batch scheduler needs it to place the job
+struct JobPlan {
+    std::string region;
+    std::string mode;
+    size_t steps = 0;       // time steps per replica
+    size_t synapses = 0;    // simulated synapse replicas in total
+    size_t threads = 1;     // threads the run's parallel part spreads over
+    uint64_t arena_bytes = 0; // per-run state a run arena should hold (single mode)
+    std::vector<std::pair<std::string, uint64_t>> memory;  // peak bytes per subsystem
+    std::vector<std::pair<std::string, uint64_t>> outputs; // bytes per output file
+    std::vector<std::pair<std::string, double>> runtime;   // seconds per phase
+
+    uint64_t peak_memory() const;
+    uint64_t output_bytes() const;
+    double seconds() const;
+};
+
+// Predicts the steps, memory, outputs and runtime of `config` without running it.
+// The mirror of synapse_sim's modes: keep the defaults here in step with them.
+JobPlan plan_job(const Config& config, const KernelCosts& costs);
+
+// Fraction of steps with a pre or post spike under the config's synthetic
+// activity (random, or spike_correlation trains)
+double synthetic_event_fraction(const Config& config);
+
+// Run-arena bytes of a single-mode run of `steps` steps: every trajectory row,
+// plus the pooled spike-event buffers when event_output is set. Reads only the
+// config, so run_single can size its arena with it before every run.
+uint64_t single_arena_bytes(const Config& config, size_t steps, double event_fraction);
+
+// Human-readable report, or one JSON object per line with `json`
+void print_plan(std::ostream& out, const JobPlan& plan, bool json);
+
+#endif // JOB_PLAN_H
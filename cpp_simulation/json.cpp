@@ -0,0 +1,326 @@
+#include "json.h"
+#include <cstdio>
+#include <cstdlib>
+
+JsonError::JsonError(const std::string& message, size_t line, size_t column)
+    : std::runtime_error("line " + std::to_string(line) + ", column " + std::to_string(column) + ": " + message),
+      line(line),
+      column(column) {}
+
+namespace {
+
+// Nesting deeper than this is rejected instead of recursing until the stack runs out
+const int kMaxDepth = 512;
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : text(text) {}
+
+    JsonValue parse_document() {
+        JsonValue value = parse_value(0);
+        skip_whitespace();
+        if (pos < text.size()) fail("unexpected text after the top-level value");
+        return value;
+    }
+
+private:
+    const std::string& text;
+    size_t pos = 0;
+    size_t line = 1;
+    size_t line_start = 0;
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw JsonError(message, line, pos - line_start + 1);
+    }
+
+    void skip_whitespace() {
+        while (pos < text.size()) {
+            char c = text[pos];
+            if (c == '\n') {
+                ++line;
+                line_start = pos + 1;
+            } else if (c != ' ' && c != '\t' && c != '\r') {
+                return;
+            }
+            ++pos;
+        }
+    }
+
+    void expect_word(const char* word) {
+        for (const char* c = word; *c; ++c, ++pos) {
+            if (pos >= text.size() || text[pos] != *c) fail(std::string("invalid literal, expected '") + word + "'");
+        }
+    }
+
+    JsonValue parse_value(int depth) {
+        skip_whitespace();
+        if (pos >= text.size()) fail("unexpected end of input");
+        if (depth > kMaxDepth) fail("nesting is too deep");
+
+        JsonValue value;
+        value.line = line;
+        value.column = pos - line_start + 1;
+        char c = text[pos];
+        if (c == '{') {
+            parse_object(value, depth);
+        } else if (c == '[') {
+            parse_array(value, depth);
+        } else if (c == '"') {
+            value.type = JsonValue::Type::String;
+            value.text = parse_string();
+        } else if (c == 't' || c == 'f') {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = c == 't';
+            expect_word(value.boolean ? "true" : "false");
+        } else if (c == 'n') {
+            expect_word("null");
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            parse_number(value);
+        } else {
+            fail(std::string("unexpected character '") + c + "'");
+        }
+        return value;
+    }
+
+    void parse_object(JsonValue& value, int depth) {
+        value.type = JsonValue::Type::Object;
+        ++pos;
+        skip_whitespace();
+        if (pos < text.size() && text[pos] == '}') {
+            ++pos;
+            return;
+        }
+        while (true) {
+            skip_whitespace();
+            if (pos >= text.size() || text[pos] != '"') fail("expected a quoted member name");
+            std::string key = parse_string();
+            skip_whitespace();
+            if (pos >= text.size() || text[pos] != ':') fail("expected ':' after member name");
+            ++pos;
+            value.members.emplace_back(std::move(key), parse_value(depth + 1));
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == ',') {
+                ++pos;
+                continue;
+            }
+            if (pos < text.size() && text[pos] == '}') {
+                ++pos;
+                return;
+            }
+            fail("expected ',' or '}' in object");
+        }
+    }
+
+    void parse_array(JsonValue& value, int depth) {
+        value.type = JsonValue::Type::Array;
+        ++pos;
+        skip_whitespace();
+        if (pos < text.size() && text[pos] == ']') {
+            ++pos;
+            return;
+        }
+        while (true) {
+            value.items.push_back(parse_value(depth + 1));
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == ',') {
+                ++pos;
+                continue;
+            }
+            if (pos < text.size() && text[pos] == ']') {
+                ++pos;
+                return;
+            }
+            fail("expected ',' or ']' in array");
+        }
+    }
+
+    void parse_number(JsonValue& value) {
+        const size_t start = pos;
+        auto digits = [this]() {
+            size_t first = pos;
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') ++pos;
+            return pos - first;
+        };
+        if (text[pos] == '-') ++pos;
+        if (pos < text.size() && text[pos] == '0') {
+            ++pos;
+        } else if (digits() == 0) {
+            fail("invalid number");
+        }
+        if (pos < text.size() && text[pos] == '.') {
+            ++pos;
+            if (digits() == 0) fail("expected digits after the decimal point");
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            ++pos;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) ++pos;
+            if (digits() == 0) fail("expected digits in the exponent");
+        }
+        value.type = JsonValue::Type::Number;
+        value.text = text.substr(start, pos - start);
+        value.number = std::strtod(value.text.c_str(), nullptr);
+    }
+
+    unsigned parse_hex4() {
+        if (pos + 4 > text.size()) fail("truncated \\u escape");
+        unsigned code = 0;
+        for (int i = 0; i < 4; ++i, ++pos) {
+            char c = text[pos];
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else fail("invalid \\u escape");
+        }
+        return code;
+    }
+
+    static void append_utf8(std::string& out, unsigned code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    std::string parse_string() {
+        ++pos; // opening quote
+        std::string out;
+        while (true) {
+            if (pos >= text.size()) fail("unterminated string");
+            char c = text[pos];
+            if (c == '"') {
+                ++pos;
+                return out;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) fail("control character in string");
+            if (c != '\\') {
+                out += c;
+                ++pos;
+                continue;
+            }
+            if (++pos >= text.size()) fail("unterminated escape");
+            char escape = text[pos++];
+            switch (escape) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned code = parse_hex4();
+                    // A high surrogate must be followed by its low half
+                    if (code >= 0xD800 && code < 0xDC00) {
+                        if (pos + 2 > text.size() || text[pos] != '\\' || text[pos + 1] != 'u') fail("unpaired surrogate");
+                        pos += 2;
+                        unsigned low = parse_hex4();
+                        if (low < 0xDC00 || low >= 0xE000) fail("unpaired surrogate");
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (code >= 0xDC00 && code < 0xE000) {
+                        fail("unpaired surrogate");
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default:
+                    --pos;
+                    fail(std::string("invalid escape '\\") + escape + "'");
+            }
+        }
+    }
+};
+
+void dump_string(const std::string& value, std::string& out) {
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void dump_value(const JsonValue& value, std::string& out) {
+    switch (value.type) {
+        case JsonValue::Type::Null: out += "null"; break;
+        case JsonValue::Type::Bool: out += value.boolean ? "true" : "false"; break;
+        case JsonValue::Type::Number: out += value.text; break;
+        case JsonValue::Type::String: dump_string(value.text, out); break;
+        case JsonValue::Type::Array:
+            out += '[';
+            for (size_t i = 0; i < value.items.size(); ++i) {
+                if (i) out += ',';
+                dump_value(value.items[i], out);
+            }
+            out += ']';
+            break;
+        case JsonValue::Type::Object:
+            out += '{';
+            for (size_t i = 0; i < value.members.size(); ++i) {
+                if (i) out += ',';
+                dump_string(value.members[i].first, out);
+                out += ':';
+                dump_value(value.members[i].second, out);
+            }
+            out += '}';
+            break;
+    }
+}
+
+} // namespace
+
+// --- JsonValue Class Implementation ---
+
+JsonValue JsonValue::parse(const std::string& text) {
+    return JsonParser(text).parse_document();
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    for (auto it = members.rbegin(); it != members.rend(); ++it) {
+        if (it->first == key) return &it->second;
+    }
+    return nullptr;
+}
+
+std::string JsonValue::dump() const {
+    std::string out;
+    dump_value(*this, out);
+    return out;
+}
+
+const char* JsonValue::type_name() const {
+    switch (type) {
+        case Type::Null: return "null";
+        case Type::Bool: return "boolean";
+        case Type::Number: return "number";
+        case Type::String: return "string";
+        case Type::Array: return "array";
+        case Type::Object: return "object";
+    }
+    return "value";
+}
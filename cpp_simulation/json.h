@@ -0,0 +1,47 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Syntax error in JSON text, with the 1-based position it was found at
+class JsonError : public std::runtime_error {
+public:
+    JsonError(const std::string& message, size_t line, size_t column);
+    size_t line;
+    size_t column;
+};
+
+// A parsed JSON document (RFC 8259). Objects keep their members in file order.
+// Every value remembers where it started, so later checks (wrong type, missing
+// member) can point at the offending line and column.
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    // Parses a whole document in one pass; throws JsonError on malformed input
+    static JsonValue parse(const std::string& text);
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string text; // string contents, or a number exactly as written
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+    size_t line = 0;
+    size_t column = 0;
+
+    bool is_object() const { return type == Type::Object; }
+    bool is_array() const { return type == Type::Array; }
+    // Member `key` of an object, or nullptr (the last one wins for duplicate keys)
+    const JsonValue* find(const std::string& key) const;
+    // Compact JSON text of this value (numbers keep their original spelling)
+    std::string dump() const;
+    // "number", "string", ... for error messages
+    const char* type_name() const;
+};
+
+#endif // JSON_H
@@ -0,0 +1,75 @@
+#include "live_stream.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static_assert(sizeof(LiveStreamHeader) == 64, "live stream header layout is part of the reader protocol");
+static_assert(sizeof(LiveStreamSlot) == 40, "live stream slot layout is part of the reader protocol");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock fields must be lock-free to be shared across processes");
+
+// --- LiveStream Class Implementation ---
+
+LiveStream::LiveStream(const std::string& name, const std::string& region, size_t capacity)
+    : name(name), capacity(capacity ? capacity : 1) {
+    // A fresh segment per run: readers still mapping the old one keep their copy
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Could not create shared memory " << name << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    size_t bytes = sizeof(LiveStreamHeader) + this->capacity * sizeof(LiveStreamSlot);
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        std::cerr << "Error: Could not size shared memory " << name << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        shm_unlink(name.c_str());
+        return;
+    }
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Error: Could not map shared memory " << name << ": " << std::strerror(errno) << std::endl;
+        shm_unlink(name.c_str());
+        return;
+    }
+    mapped_bytes = bytes;
+
+    // ftruncate zero-fills, so every slot starts with seq 0 (never valid for any record)
+    header = static_cast<LiveStreamHeader*>(memory);
+    slots = reinterpret_cast<LiveStreamSlot*>(header + 1);
+    header->version = kLiveStreamVersion;
+    header->slot_size = sizeof(LiveStreamSlot);
+    header->capacity = this->capacity;
+    std::strncpy(header->region, region.c_str(), sizeof(header->region) - 1);
+    // Readers check the magic last, so it is written once everything else is in place
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, "QDLIVE1", 8);
+}
+
+LiveStream::~LiveStream() {
+    if (!header) return;
+    finish();
+    munmap(header, mapped_bytes);
+}
+
+void LiveStream::publish(double time, double pre_activity, double post_activity, double synaptic_weight) {
+    if (!header) return;
+    LiveStreamSlot& slot = slots[next % capacity];
+    slot.seq.store(2 * next + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.time = time;
+    slot.pre_activity = pre_activity;
+    slot.post_activity = post_activity;
+    slot.synaptic_weight = synaptic_weight;
+    slot.seq.store(2 * next + 2, std::memory_order_release);
+    ++next;
+    header->published.store(next, std::memory_order_release);
+}
+
+void LiveStream::finish() {
+    if (!header) return;
+    header->finished.store(1, std::memory_order_release);
+}
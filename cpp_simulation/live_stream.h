@@ -0,0 +1,78 @@
+#ifndef LIVE_STREAM_H
+#define LIVE_STREAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Layout of a live stream segment (POSIX shared memory, /dev/shm/<name> on Linux).
+// All fields are native-endian; offsets are fixed so non-C++ readers
+// (python_visualization/live_reader.py) can map the segment directly.
+//
+//   offset  size  field
+//        0     8  magic "QDLIVE1\0"
+//        8     4  version (uint32, 1)
+//       12     4  slot_size (uint32, bytes per slot, 40)
+//       16     8  capacity (uint64, slots in the ring)
+//       24     8  published (uint64, records committed so far)
+//       32     4  finished (uint32, 1 once the run is over)
+//       36     4  reserved
+//       40    24  region (NUL-padded)
+//       64     -  capacity slots of {uint64 seq, double time, pre, post, weight}
+//
+// Record n lives in slot n % capacity. Each slot is a seqlock: the producer sets
+// seq to 2n+1, writes the payload, then sets seq to 2n+2 and bumps `published`.
+// A reader wanting record n reads seq, copies the payload and reads seq again;
+// the copy is valid only if both reads equal 2n+2. Anything else means the slot
+// is being rewritten or already holds a newer record, and the reader skips ahead.
+// Readers never write to the segment, so any number can follow one producer
+// and the producer never waits for them.
+struct LiveStreamHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t capacity;
+    std::atomic<uint64_t> published;
+    std::atomic<uint32_t> finished;
+    uint32_t reserved;
+    char region[24];
+};
+
+struct LiveStreamSlot {
+    std::atomic<uint64_t> seq;
+    double time;
+    double pre_activity;
+    double post_activity;
+    double synaptic_weight;
+};
+
+const uint32_t kLiveStreamVersion = 1;
+
+// Producer side of a live stream: publishes recorded samples as they are computed
+class LiveStream {
+public:
+    // Creates (or recreates) the segment `name` ("/qd_live_cortex") with room
+    // for `capacity` records; is_open() reports whether that succeeded.
+    LiveStream(const std::string& name, const std::string& region, size_t capacity);
+    ~LiveStream();
+
+    bool is_open() const { return header != nullptr; }
+    void publish(double time, double pre_activity, double post_activity, double synaptic_weight);
+    // Marks the run as over; readers drain what is left and stop. The segment
+    // stays until the next run recreates it or a reader unlinks it.
+    void finish();
+
+private:
+    LiveStream(const LiveStream&) = delete;
+    LiveStream& operator=(const LiveStream&) = delete;
+
+    std::string name;
+    size_t capacity;
+    size_t mapped_bytes = 0;
+    LiveStreamHeader* header = nullptr;
+    LiveStreamSlot* slots = nullptr;
+    uint64_t next = 0;
+};
+
+#endif // LIVE_STREAM_H
@@ -0,0 +1,145 @@
+#include "lod_pyramid.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// Buckets of 2^level samples needed to cover `samples`
+uint64_t bucket_count(uint64_t samples, size_t level) {
+    return (samples + (uint64_t(1) << level) - 1) >> level;
+}
+
+} // namespace
+
+// --- LodBuilder Class Implementation ---
+
+bool LodBuilder::open(const std::string& path, size_t count) {
+    filepath = path;
+    expected = count;
+    samples = 0;
+    outfile.open(filepath, std::ios::binary | std::ios::trunc);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return false;
+    }
+
+    // Level sizes follow from the sample count, so every level's place is known now
+    top = kLodFirstLevel;
+    while (bucket_count(count, top) > 1) ++top;
+    levels.clear();
+    if (count > 0) levels.resize(top - kLodFirstLevel + 1);
+    uint64_t offset = 64 + levels.size() * 2 * sizeof(uint64_t);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        levels[i].offset = offset;
+        levels[i].count = bucket_count(count, kLodFirstLevel + i);
+        levels[i].batch.reserve(kLodBatchBuckets);
+        offset += levels[i].count * sizeof(LodBucket);
+    }
+    pending.assign(top, Pending());
+    return true;
+}
+
+void LodBuilder::add(double weight, double pre_activity, double post_activity) {
+    if (samples++ >= expected) return; // reported by finish()
+    const double values[kLodChannels] = {weight, pre_activity, post_activity};
+    LodBucket bucket;
+    for (int c = 0; c < kLodChannels; ++c) {
+        bucket.min[c] = bucket.max[c] = bucket.mean[c] = static_cast<float>(values[c]);
+    }
+    push(0, bucket, values, 1);
+}
+
+void LodBuilder::push(size_t level, const LodBucket& bucket, const double* sum, size_t count) {
+    if (level >= kLodFirstLevel) {
+        Level& stored = levels[level - kLodFirstLevel];
+        stored.batch.push_back(bucket);
+        if (stored.batch.size() == kLodBatchBuckets) write_batch(stored);
+    }
+    if (level == top) return;
+
+    Pending& parent = pending[level];
+    if (parent.children == 0) {
+        parent.bucket = bucket;
+        for (int c = 0; c < kLodChannels; ++c) parent.sum[c] = sum[c];
+        parent.count = count;
+    } else {
+        for (int c = 0; c < kLodChannels; ++c) {
+            if (bucket.min[c] < parent.bucket.min[c]) parent.bucket.min[c] = bucket.min[c];
+            if (bucket.max[c] > parent.bucket.max[c]) parent.bucket.max[c] = bucket.max[c];
+            parent.sum[c] += sum[c];
+        }
+        parent.count += count;
+    }
+    if (++parent.children < 2) return;
+
+    // Both children seen: the parent bucket is complete
+    Pending done = parent;
+    parent.children = 0;
+    for (int c = 0; c < kLodChannels; ++c) done.bucket.mean[c] = static_cast<float>(done.sum[c] / done.count);
+    push(level + 1, done.bucket, done.sum, done.count);
+}
+
+void LodBuilder::write_batch(Level& level) {
+    if (level.batch.empty()) return;
+    outfile.seekp(static_cast<std::streamoff>(level.offset + level.written * sizeof(LodBucket)));
+    outfile.write(reinterpret_cast<const char*>(level.batch.data()),
+                  static_cast<std::streamsize>(level.batch.size() * sizeof(LodBucket)));
+    level.written += level.batch.size();
+    level.batch.clear();
+}
+
+bool LodBuilder::finish(const std::string& region, double time_start, double time_step) {
+    if (!outfile.is_open()) return false;
+    if (samples != expected) {
+        std::cerr << "Error: Level-of-detail pyramid " << filepath << " expected " << expected << " samples, got "
+                  << samples << std::endl;
+        return false;
+    }
+
+    // A lone trailing child becomes a partial bucket one level up, up to the
+    // single bucket covering every sample
+    for (size_t level = 0; level < top; ++level) {
+        Pending& parent = pending[level];
+        if (parent.children == 1) {
+            Pending partial = parent;
+            parent.children = 0;
+            for (int c = 0; c < kLodChannels; ++c) partial.bucket.mean[c] = static_cast<float>(partial.sum[c] / partial.count);
+            push(level + 1, partial.bucket, partial.sum, partial.count);
+        }
+    }
+    for (auto& level : levels) write_batch(level);
+
+    char header[64] = {};
+    std::memcpy(header, "QDLOD1", 6);
+    uint32_t fields[4] = {2, kLodChannels, static_cast<uint32_t>(levels.size()), static_cast<uint32_t>(kLodFirstLevel)};
+    std::memcpy(header + 8, fields, sizeof(fields));
+    uint64_t count = samples;
+    std::memcpy(header + 24, &count, 8);
+    std::memcpy(header + 32, &time_start, 8);
+    std::memcpy(header + 40, &time_step, 8);
+    std::strncpy(header + 48, region.c_str(), 15);
+    outfile.seekp(0);
+    outfile.write(header, sizeof(header));
+    for (const auto& level : levels) {
+        uint64_t entry[2] = {level.offset, level.count};
+        outfile.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+    }
+    outfile.close();
+    if (!outfile) {
+        std::cerr << "Error: Could not write " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// --- Trajectory Export ---
+
+bool save_lod_pyramid(const SimRows& trajectory, const std::string& filepath) {
+    LodBuilder builder;
+    if (!builder.open(filepath, trajectory.size())) return false;
+    for (const auto& row : trajectory) builder.add(row.synaptic_weight, row.pre_activity, row.post_activity);
+    double start = trajectory.empty() ? 0.0 : trajectory.front().time;
+    double step = trajectory.size() > 1 ? (trajectory.back().time - start) / (trajectory.size() - 1) : 0.0;
+    return builder.finish(trajectory.empty() ? "" : trajectory.front().region, start, step);
+}
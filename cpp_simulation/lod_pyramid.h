@@ -0,0 +1,90 @@
+#ifndef LOD_PYRAMID_H
+#define LOD_PYRAMID_H
+
+#include "synapse.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Level-of-detail pyramid of a trajectory: level L holds one {min, max, mean}
+// bucket per 2^L consecutive samples for each channel (synaptic_weight,
+// pre_activity, post_activity). Levels below kLodFirstLevel are not stored; a
+// zoom finer than 2^kLodFirstLevel samples per bucket reads the raw trace. A
+// reader serves any wider window by reading about `pixels` buckets of the
+// coarsest level that still resolves it (python_visualization/lod_reader.py).
+//
+// File layout (native-endian):
+//   offset  size  field
+//        0     8  magic "QDLOD1\0\0"
+//        8     4  version (uint32, 2)
+//       12     4  channels (uint32, 3)
+//       16     4  levels (uint32, stored levels)
+//       20     4  first_level (uint32, level of the first stored entry)
+//       24     8  samples (uint64)
+//       32     8  time_start (double, time of sample 0)
+//       40     8  time_step (double, sample i is at time_start + i * time_step)
+//       48    16  region (NUL-padded)
+//       64     -  levels x {uint64 offset, uint64 count}, then each level's buckets
+//                 of channels x {float min, float max, float mean}
+const int kLodChannels = 3;
+const size_t kLodFirstLevel = 3;
+// Completed buckets a level holds before they are written out
+const size_t kLodBatchBuckets = 1024;
+
+struct LodBucket {
+    float min[kLodChannels];
+    float max[kLodChannels];
+    float mean[kLodChannels];
+};
+
+// Builds the pyramid one sample at a time, so it can be fed while a run records.
+// Every sample touches O(1) buckets amortized (a carry chain, like a binary
+// counter). The sample count is fixed up front, which fixes where each level
+// starts in the file, so completed buckets are written out in small batches and
+// memory stays at one batch per level however long the trajectory is.
+class LodBuilder {
+public:
+    // Creates `filepath` for exactly `samples` samples; returns false on I/O error
+    bool open(const std::string& filepath, size_t samples);
+    void add(double weight, double pre_activity, double post_activity);
+    // Flushes partial buckets and writes the header; returns false on I/O error
+    // or if fewer or more samples than announced were added
+    bool finish(const std::string& region, double time_start, double time_step);
+
+    size_t num_samples() const { return samples; }
+
+private:
+    // Running bucket at one level, combined from whole child buckets
+    struct Pending {
+        LodBucket bucket;
+        double sum[kLodChannels];
+        size_t count = 0;  // samples covered
+        size_t children = 0;
+    };
+
+    // Stored level: its place in the file and the buckets not yet written there
+    struct Level {
+        uint64_t offset = 0;
+        uint64_t count = 0;
+        uint64_t written = 0;
+        std::vector<LodBucket> batch;
+    };
+
+    void push(size_t level, const LodBucket& bucket, const double* sum, size_t count);
+    void write_batch(Level& level);
+
+    std::ofstream outfile;
+    std::string filepath;
+    size_t expected = 0;
+    size_t top = 0;               // level holding a single bucket
+    std::vector<Pending> pending; // pending[L] feeds level L + 1
+    std::vector<Level> levels;    // levels[i] is level kLodFirstLevel + i
+    size_t samples = 0;
+};
+
+// Builds and writes the pyramid for a recorded trajectory
+bool save_lod_pyramid(const SimRows& trajectory, const std::string& filepath);
+
+#endif // LOD_PYRAMID_H
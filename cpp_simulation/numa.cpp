@@ -0,0 +1,140 @@
+#include "numa.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sched.h>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// mbind(2) arguments, from <numaif.h>, so no libnuma is needed
+const int kMpolPreferred = 1;
+const unsigned kMpolMfMove = 1u << 1;
+
+// "0-3,8-11" -> {0, 1, 2, 3, 8, 9, 10, 11}
+std::vector<int> parse_cpu_list(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream ss(text);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        try {
+            std::string::size_type dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+    return cpus;
+}
+
+} // namespace
+
+bool parse_affinity(const std::string& name, AffinityPolicy& policy) {
+    if (name == "none") policy = AffinityPolicy::None;
+    else if (name == "compact") policy = AffinityPolicy::Compact;
+    else if (name == "spread") policy = AffinityPolicy::Spread;
+    else return false;
+    return true;
+}
+
+// --- NumaTopology Class Implementation ---
+
+const NumaTopology& NumaTopology::detect() {
+    static const NumaTopology topology = [] {
+        NumaTopology result;
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        const bool restricted = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        auto usable = [&](int cpu) { return !restricted || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)); };
+
+        for (int node = 0; node < 64; ++node) {
+            std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!list.is_open()) continue;
+            std::string text;
+            std::getline(list, text);
+            std::vector<int> cpus;
+            for (int cpu : parse_cpu_list(text)) {
+                if (usable(cpu)) cpus.push_back(cpu);
+            }
+            // Memory-only nodes and nodes outside the affinity mask are skipped, so
+            // the kernel's node number is kept alongside the CPUs
+            if (!cpus.empty()) {
+                result.node_cpus.push_back(cpus);
+                result.node_ids.push_back(node);
+            }
+        }
+        if (result.node_cpus.empty()) {
+            // No sysfs node information: every allowed CPU forms one node
+            std::vector<int> cpus;
+            if (restricted) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+                }
+            } else {
+                const long online = sysconf(_SC_NPROCESSORS_ONLN);
+                for (long cpu = 0; cpu < online && cpu < CPU_SETSIZE; ++cpu) cpus.push_back(static_cast<int>(cpu));
+            }
+            if (cpus.empty()) cpus.push_back(0);
+            result.node_cpus.push_back(cpus);
+            result.node_ids.push_back(0);
+        }
+        return result;
+    }();
+    return topology;
+}
+
+int NumaTopology::node_of(int cpu) const {
+    for (size_t node = 0; node < node_cpus.size(); ++node) {
+        if (std::find(node_cpus[node].begin(), node_cpus[node].end(), cpu) != node_cpus[node].end()) {
+            return node_ids[node];
+        }
+    }
+    return -1;
+}
+
+std::vector<int> NumaTopology::plan(AffinityPolicy policy, size_t workers) const {
+    std::vector<int> cpus;
+    if (policy == AffinityPolicy::Compact) {
+        std::vector<int> ordered;
+        for (const auto& node : node_cpus) ordered.insert(ordered.end(), node.begin(), node.end());
+        for (size_t i = 0; i < workers; ++i) cpus.push_back(ordered[i % ordered.size()]);
+    } else if (policy == AffinityPolicy::Spread) {
+        const size_t nodes = node_cpus.size();
+        for (size_t i = 0; i < workers; ++i) {
+            const auto& node = node_cpus[i % nodes];
+            cpus.push_back(node[(i / nodes) % node.size()]);
+        }
+    }
+    return cpus;
+}
+
+bool pin_current_thread(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+bool bind_to_node(void* data, size_t bytes, int node) {
+#ifdef SYS_mbind
+    if (node < 0 || node >= 64 || bytes == 0) return false;
+    // mbind works on whole pages; partial pages at either end stay where they are
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + page - 1) / page * page;
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) / page * page;
+    if (end <= begin) return false;
+    unsigned long mask = 1ul << node;
+    return syscall(SYS_mbind, begin, end - begin, kMpolPreferred, &mask, 8 * sizeof(mask) + 1, kMpolMfMove) == 0;
+#else
+    (void)data;
+    (void)bytes;
+    (void)node;
+    return false;
+#endif
+}
@@ -0,0 +1,77 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Where worker threads run. Memory a thread touches first is placed on that
+// thread's NUMA node, so pinned workers keep the arrays they fill local.
+//   none     the scheduler decides (the default)
+//   compact  fill the CPUs of one node before moving to the next
+//   spread   deal workers round-robin across nodes, for memory bandwidth
+enum class AffinityPolicy { None, Compact, Spread };
+
+// Parses "none", "compact" or "spread"; returns false for anything else
+bool parse_affinity(const std::string& name, AffinityPolicy& policy);
+
+// CPUs this process may run on, grouped by NUMA node (read from
+// /sys/devices/system/node). Machines without NUMA information are one node.
+class NumaTopology {
+public:
+    static const NumaTopology& detect();
+
+    size_t num_nodes() const { return node_cpus.size(); }
+    const std::vector<int>& cpus(size_t node) const { return node_cpus[node]; }
+    // Kernel node number of `cpu`, or -1 if it is not one this process may use
+    int node_of(int cpu) const;
+
+    // CPU for each of `workers` threads under `policy`; empty for None
+    std::vector<int> plan(AffinityPolicy policy, size_t workers) const;
+
+private:
+    std::vector<std::vector<int>> node_cpus;
+    std::vector<int> node_ids; // sysfs node number of each entry of node_cpus
+};
+
+// Restricts the calling thread to `cpu`
+bool pin_current_thread(int cpu);
+
+// Asks the kernel to keep the whole pages inside [data, data + bytes) on `node`,
+// moving any already placed elsewhere. A failure (no NUMA support, or a
+// single-node machine) leaves placement to first touch; results never depend on it.
+bool bind_to_node(void* data, size_t bytes, int node);
+
+// Allocator that leaves trivially constructible elements uninitialized on
+// resize, so the pages of a large array are first touched, and placed, by the
+// worker that fills them rather than by the thread that allocated them.
+template <typename T>
+class FirstTouchAllocator : public std::allocator<T> {
+public:
+    template <typename U>
+    struct rebind {
+        using other = FirstTouchAllocator<U>;
+    };
+
+    FirstTouchAllocator() noexcept {}
+    template <typename U>
+    FirstTouchAllocator(const FirstTouchAllocator<U>&) noexcept {}
+
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+template <typename T>
+using FirstTouchVector = std::vector<T, FirstTouchAllocator<T>>;
+
+#endif // NUMA_H
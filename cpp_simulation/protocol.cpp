@@ -0,0 +1,156 @@
+#include "protocol.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+// Settings each block kind accepts, with their defaults
+const std::map<std::string, std::map<std::string, double>> kBlockDefaults = {
+    {"train", {{"pulses", 100}, {"rate", 100}}},
+    {"theta_burst", {{"bursts", 10}, {"pulses", 4}, {"rate", 100}, {"burst_rate", 5}}},
+    {"paired_pulse", {{"interval", 0.05}}},
+    {"pairing", {{"pulses", 60}, {"rate", 1}, {"delay", 0.01}}},
+};
+
+struct Block {
+    std::string kind;
+    std::map<std::string, double> settings;
+    bool pre = true;
+    bool post = false;
+};
+
+bool parse_block(const std::string& text, Block& block) {
+    std::istringstream tokens(text);
+    if (!(tokens >> block.kind)) return false;
+    auto defaults = kBlockDefaults.find(block.kind);
+    if (defaults == kBlockDefaults.end()) {
+        std::cerr << "Error: Unknown protocol block '" << block.kind
+                  << "' (expected train, theta_burst, paired_pulse or pairing)." << std::endl;
+        return false;
+    }
+    block.settings = defaults->second;
+    block.settings["start"] = 0;
+    block.settings["trials"] = 1;
+    block.settings["iti"] = 10;
+
+    std::string token;
+    while (tokens >> token) {
+        std::string::size_type equals = token.find('=');
+        std::string name = token.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : token.substr(equals + 1);
+        if (name == "channel" && block.kind != "pairing") {
+            if (value != "pre" && value != "post" && value != "both") {
+                std::cerr << "Error: Protocol channel must be pre, post or both, not '" << value << "'." << std::endl;
+                return false;
+            }
+            block.pre = value != "post";
+            block.post = value != "pre";
+            continue;
+        }
+        if (block.settings.find(name) == block.settings.end()) {
+            std::cerr << "Error: Protocol block '" << block.kind << "' has no setting '" << name << "'." << std::endl;
+            return false;
+        }
+        try {
+            size_t used = 0;
+            block.settings[name] = std::stod(value, &used);
+            if (used != value.size()) throw std::invalid_argument(value);
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid value '" << value << "' for protocol setting '" << name << "'." << std::endl;
+            return false;
+        }
+    }
+
+    for (const char* count : {"pulses", "bursts", "trials"}) {
+        auto setting = block.settings.find(count);
+        if (setting != block.settings.end() && (setting->second < 1 || setting->second != std::floor(setting->second))) {
+            std::cerr << "Error: Protocol setting '" << count << "' must be a positive integer." << std::endl;
+            return false;
+        }
+    }
+    for (const char* rate : {"rate", "burst_rate"}) {
+        auto setting = block.settings.find(rate);
+        if (setting != block.settings.end() && !(setting->second > 0)) {
+            std::cerr << "Error: Protocol setting '" << rate << "' must be positive." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Appends one trial of a block starting at `start`
+void expand_trial(const Block& block, double start, std::vector<StimulusEvent>& events) {
+    const auto& s = block.settings;
+    if (block.kind == "train") {
+        for (int p = 0; p < static_cast<int>(s.at("pulses")); ++p) {
+            events.push_back({start + p / s.at("rate"), block.pre, block.post});
+        }
+    } else if (block.kind == "theta_burst") {
+        for (int b = 0; b < static_cast<int>(s.at("bursts")); ++b) {
+            for (int p = 0; p < static_cast<int>(s.at("pulses")); ++p) {
+                events.push_back({start + b / s.at("burst_rate") + p / s.at("rate"), block.pre, block.post});
+            }
+        }
+    } else if (block.kind == "paired_pulse") {
+        events.push_back({start, block.pre, block.post});
+        events.push_back({start + s.at("interval"), block.pre, block.post});
+    } else {
+        for (int p = 0; p < static_cast<int>(s.at("pulses")); ++p) {
+            double pre_time = start + p / s.at("rate");
+            events.push_back({pre_time, true, false});
+            events.push_back({pre_time + s.at("delay"), false, true});
+        }
+    }
+}
+
+} // namespace
+
+bool compile_protocol(const std::string& protocol, std::vector<StimulusEvent>& schedule) {
+    std::vector<StimulusEvent> events;
+    std::istringstream blocks(protocol);
+    std::string text;
+    while (std::getline(blocks, text, ';')) {
+        if (text.find_first_not_of(" \t\r\n") == std::string::npos) continue;
+        Block block;
+        if (!parse_block(text, block)) return false;
+        for (int trial = 0; trial < static_cast<int>(block.settings["trials"]); ++trial) {
+            expand_trial(block, block.settings["start"] + trial * block.settings["iti"], events);
+        }
+    }
+
+    // Sort once up front so the run loop only ever steps a cursor forward
+    std::stable_sort(events.begin(), events.end(),
+                     [](const StimulusEvent& a, const StimulusEvent& b) { return a.time < b.time; });
+    schedule.clear();
+    for (const auto& event : events) {
+        if (event.time < 0) continue;
+        if (!schedule.empty() && schedule.back().time == event.time) {
+            schedule.back().pre = schedule.back().pre || event.pre;
+            schedule.back().post = schedule.back().post || event.post;
+        } else {
+            schedule.push_back(event);
+        }
+    }
+    return true;
+}
+
+// --- ProtocolActivity Class Implementation ---
+
+ProtocolActivity::ProtocolActivity(std::vector<StimulusEvent> schedule) : schedule(std::move(schedule)) {}
+
+void ProtocolActivity::next(double t, double dt, double& pre_activity, double& post_activity) {
+    pre_activity = 0.0;
+    post_activity = 0.0;
+    // `t` accumulates rounding in the run loop; a pulse on a step boundary (1.0 with
+    // dt = 0.001) belongs to the step starting there, not the one ending there
+    const double step_end = t + dt * (1.0 - 1e-6);
+    while (cursor < schedule.size() && schedule[cursor].time < step_end) {
+        if (schedule[cursor].pre) pre_activity = 1.0;
+        if (schedule[cursor].post) post_activity = 1.0;
+        ++cursor;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "synapse.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Structured stimulation for LTP/LTD experiments. A protocol is a list of
+// blocks separated by ';', each a block kind followed by name=value settings
+// (times in simulation units, taken as seconds; rates in Hz):
+//
+//   "theta_burst start=10 trials=3 iti=20; pairing start=100 pulses=60 delay=0.01"
+//
+// Kinds and their settings (defaults in parentheses):
+//   train         pulses (100), rate (100), channel (pre)    a tetanic train
+//   theta_burst   bursts (10), pulses (4), rate (100),       bursts of pulses at
+//                 burst_rate (5), channel (pre)               the theta rhythm
+//   paired_pulse  interval (0.05), channel (pre)             two pulses
+//   pairing       pulses (60), rate (1), delay (0.01)        pre then post after
+//                                                            `delay` (< 0: post first)
+// Every block also takes start (0), trials (1) and iti (10, start-to-start
+// interval between trials); channel is pre, post or both.
+
+struct StimulusEvent {
+    double time;
+    bool pre;
+    bool post;
+};
+
+// Compiles a protocol into its schedule, sorted by time with simultaneous
+// pulses merged; returns false (after reporting the problem) on a bad protocol
+bool compile_protocol(const std::string& protocol, std::vector<StimulusEvent>& schedule);
+
+// Plays a compiled schedule into Simulation::run: a channel is active during a
+// step if one of its pulses falls in [t, t + dt). The cursor only moves
+// forward, so each step costs O(1) amortized however long the schedule is.
+class ProtocolActivity : public ActivitySource {
+public:
+    explicit ProtocolActivity(std::vector<StimulusEvent> schedule);
+    void next(double t, double dt, double& pre_activity, double& post_activity) override;
+
+    size_t num_events() const { return schedule.size(); }
+
+private:
+    std::vector<StimulusEvent> schedule;
+    size_t cursor = 0;
+};
+
+#endif // PROTOCOL_H
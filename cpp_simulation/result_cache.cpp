@@ -0,0 +1,227 @@
+#include "result_cache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Keys that only control how a run executes or is cached, not what it produces
+bool affects_output(const std::string& key) {
+    return key != "cache" && key != "cache_dir" && key != "cache_max_mb" && key != "threads" && key != "thread_affinity" &&
+           key != "autotune" && key != "autotune_cache";
+}
+
+// Numbers are rewritten in one canonical form so "10", "10.0" and "1e1" hash alike
+std::string normalize_value(const std::string& value) {
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') return value;
+    char* end = nullptr;
+    double number = std::strtod(value.c_str(), &end);
+    if (end == value.c_str() || *end != '\0') return value;
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.17g", number);
+    return buffer;
+}
+
+// Two independently seeded FNV-1a passes, each finalized with a mixer: 128 bits.
+// Fed in pieces, so a large input file is hashed without holding it in memory.
+class Hasher {
+public:
+    void update(const char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            const unsigned char c = static_cast<unsigned char>(data[i]);
+            h1 = (h1 ^ c) * 0x100000001B3ULL;
+            h2 = (h2 ^ c) * 0x100000001B3ULL;
+            h2 ^= h2 >> 29;
+        }
+        length += size;
+    }
+
+    std::string hex() const {
+        auto finalize = [](uint64_t x) {
+            x ^= x >> 33;
+            x *= 0xFF51AFD7ED558CCDULL;
+            x ^= x >> 33;
+            x *= 0xC4CEB9FE1A85EC53ULL;
+            x ^= x >> 33;
+            return x;
+        };
+        char buffer[33];
+        std::snprintf(buffer, sizeof(buffer), "%016llx%016llx",
+                      static_cast<unsigned long long>(finalize(h1)),
+                      static_cast<unsigned long long>(finalize(h2 ^ length)));
+        return buffer;
+    }
+
+private:
+    uint64_t h1 = 0xCBF29CE484222325ULL;
+    uint64_t h2 = 0x84222325CBF29CE4ULL;
+    uint64_t length = 0;
+};
+
+std::string hash_hex(const std::string& text) {
+    Hasher hasher;
+    hasher.update(text.data(), text.size());
+    return hasher.hex();
+}
+
+// Reads the file in 1 MiB chunks; a missing file hashes like an empty one
+std::string hash_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> chunk(1 << 20);
+    Hasher hasher;
+    while (file) {
+        file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        hasher.update(chunk.data(), static_cast<size_t>(file.gcount()));
+    }
+    return hasher.hex();
+}
+
+} // namespace
+
+// --- ResultCache Class Implementation ---
+
+ResultCache::ResultCache(const std::string& directory, uintmax_t max_bytes)
+    : directory(directory), max_bytes(max_bytes) {}
+
+std::string ResultCache::build_flags() {
+    std::ostringstream flags;
+#ifdef __VERSION__
+    flags << "compiler=" << __VERSION__ << ";";
+#endif
+#ifdef __OPTIMIZE__
+    flags << "optimize;";
+#endif
+#ifdef __FAST_MATH__
+    flags << "fast-math;";
+#endif
+#ifdef __FMA__
+    flags << "fma;";
+#endif
+#ifdef __AVX2__
+    flags << "avx2;";
+#endif
+#ifdef __AVX512F__
+    flags << "avx512f;";
+#endif
+#ifdef __ARM_NEON
+    flags << "neon;";
+#endif
+    return flags.str();
+}
+
+std::string ResultCache::make_key(const Config& config, const std::vector<std::string>& input_files) {
+    std::ostringstream text;
+    text << "model=" << kModelVersion << "\n";
+    text << "build=" << build_flags() << "\n";
+    // std::map keeps the keys sorted, so key order in the file does not matter
+    for (const auto& entry : config.entries()) {
+        if (!affects_output(entry.first)) continue;
+        text << entry.first << "=" << normalize_value(entry.second) << "\n";
+    }
+    for (const auto& input : input_files) text << "input=" << hash_file(input) << "\n";
+    return hash_hex(text.str());
+}
+
+bool ResultCache::restore(const std::string& key, std::vector<std::string>& restored) {
+    fs::path entry = fs::path(directory) / key;
+    std::ifstream manifest(entry / "manifest");
+    if (!manifest.is_open()) return false;
+
+    std::vector<std::pair<std::string, std::string>> files;
+    std::string blob, target;
+    while (manifest >> blob && std::getline(manifest >> std::ws, target)) {
+        files.push_back({blob, target});
+    }
+
+    std::error_code error;
+    for (const auto& file : files) {
+        if (!fs::exists(entry / file.first, error)) return false;
+    }
+    for (const auto& file : files) {
+        fs::path target_path(file.second);
+        if (target_path.has_parent_path()) fs::create_directories(target_path.parent_path(), error);
+        fs::copy_file(entry / file.first, target_path, fs::copy_options::overwrite_existing, error);
+        if (error) {
+            std::cerr << "Warning: Could not restore cached output " << file.second << ": " << error.message() << std::endl;
+            return false;
+        }
+        restored.push_back(file.second);
+    }
+
+    // Recency for LRU eviction is the manifest's modification time
+    fs::last_write_time(entry / "manifest", fs::file_time_type::clock::now(), error);
+    return true;
+}
+
+void ResultCache::store(const std::string& key, const std::vector<std::string>& outputs) {
+    std::error_code error;
+    uintmax_t total = 0;
+    for (const auto& output : outputs) {
+        uintmax_t size = fs::file_size(output, error);
+        if (error) return; // an output went missing; nothing consistent to store
+        total += size;
+    }
+    if (total > max_bytes) return;
+
+    fs::path entry = fs::path(directory) / key;
+    fs::path staging = fs::path(directory) / (key + ".partial");
+    fs::remove_all(staging, error);
+    fs::create_directories(staging, error);
+    if (error) {
+        std::cerr << "Warning: Could not create cache directory " << staging << ": " << error.message() << std::endl;
+        return;
+    }
+
+    std::ofstream manifest(staging / "manifest");
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        std::string blob = std::to_string(i);
+        fs::copy_file(outputs[i], staging / blob, fs::copy_options::overwrite_existing, error);
+        if (error) {
+            fs::remove_all(staging, error);
+            return;
+        }
+        manifest << blob << " " << outputs[i] << "\n";
+    }
+    manifest.close();
+
+    // Publish atomically so a concurrent reader never sees a half-written entry
+    fs::remove_all(entry, error);
+    fs::rename(staging, entry, error);
+    evict();
+}
+
+void ResultCache::evict() {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type last_used;
+        uintmax_t bytes;
+    };
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+
+    std::error_code error;
+    for (const auto& dir : fs::directory_iterator(directory, error)) {
+        if (!dir.is_directory(error) || dir.path().extension() == ".partial") continue;
+        Entry entry = {dir.path(), fs::last_write_time(dir.path() / "manifest", error), 0};
+        if (error) continue;
+        for (const auto& file : fs::directory_iterator(dir.path(), error)) {
+            entry.bytes += file.file_size(error);
+        }
+        total += entry.bytes;
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.last_used < b.last_used; });
+    for (const auto& entry : entries) {
+        if (total <= max_bytes) break;
+        fs::remove_all(entry.path, error);
+        total -= entry.bytes;
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "synapse.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bump whenever a change alters what the simulator writes for a given config;
+// it is part of every result-cache key, so old entries stop matching.
+const char* const kModelVersion = "1";
+
+// Local content-addressed store of simulation outputs.
+// An entry lives in <directory>/<key>/ and holds a manifest plus a copy of
+// every output file of one invocation. The key is a 128-bit hash of the
+// normalized config (seed included), the model version and the build flags,
+// so an identical rerun is answered by copying files back.
+// Entries are evicted least-recently-used first once the store exceeds max_bytes.
+class ResultCache {
+public:
+    ResultCache(const std::string& directory, uintmax_t max_bytes);
+
+    // Hash of everything that determines the outputs of a run with this config,
+    // including the contents of any input files the run reads
+    static std::string make_key(const Config& config, const std::vector<std::string>& input_files = {});
+    // Compiler, optimization and instruction-set flags the binary was built with
+    static std::string build_flags();
+
+    // Copies the outputs stored under `key` back to their original paths.
+    // Returns false on a miss or if any stored file is missing.
+    bool restore(const std::string& key, std::vector<std::string>& restored);
+    // Stores copies of `outputs` under `key`, then evicts down to the budget
+    void store(const std::string& key, const std::vector<std::string>& outputs);
+
+private:
+    void evict();
+
+    std::string directory;
+    uintmax_t max_bytes;
+};
+
+#endif // RESULT_CACHE_H
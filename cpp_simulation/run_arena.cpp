@@ -0,0 +1,50 @@
+#include "run_arena.h"
+#include <algorithm>
+#include <functional>
+
+// --- RunArena Class Implementation ---
+
+void* RunArena::OverflowResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    allocated += bytes;
+    peak = std::max(peak, allocated);
+    return p;
+}
+
+void RunArena::OverflowResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    allocated -= bytes;
+}
+
+void RunArena::reset(size_t bytes) {
+    // What the previous run used: the bump position in the buffer, or the whole
+    // buffer plus its heap spill-over
+    size_t used = buffer_bytes + heap.peak;
+    if (heap.peak == 0 && buffer_bytes > 0) {
+        std::byte* probe = static_cast<std::byte*>(monotonic->allocate(1, 1));
+        std::less<const std::byte*> before;
+        if (!before(probe, storage.get()) && before(probe, storage.get() + buffer_bytes)) {
+            used = static_cast<size_t>(probe - storage.get());
+        }
+    }
+    const size_t needed = std::max(bytes, used);
+
+    // The pool returns its chunks to the buffer first, then the buffer hands
+    // back whatever it took from the heap
+    pools.reset();
+    monotonic.reset();
+    heap.peak = 0;
+
+    if (needed > buffer_bytes) {
+        // Pages of the old buffer are already mapped; only a larger run pays to map new ones
+        storage.reset(new std::byte[needed]);
+        buffer_bytes = needed;
+    } else if (needed < buffer_bytes / kShrinkRatio) {
+        // One large run must not pin its memory on this worker for good
+        storage.reset(needed > 0 ? new std::byte[needed] : nullptr);
+        buffer_bytes = needed;
+    }
+    if (buffer_bytes > 0) monotonic.emplace(storage.get(), buffer_bytes, &heap);
+    else monotonic.emplace(&heap);
+    pools.emplace(&*monotonic);
+}
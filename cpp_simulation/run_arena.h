@@ -0,0 +1,63 @@
+#ifndef RUN_ARENA_H
+#define RUN_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+// Memory for the state of one run, reused by the next run on the same worker.
+// Allocations come from a monotonic buffer, which makes each one a pointer
+// bump. The buffer is sized from the run's plan. Small, frequently grown objects
+// such as spike-event buffers come from a pool on top of it. reset() drops
+// everything at once but keeps the buffer, so a sweep pays for its allocations
+// and page faults once rather than once per point. A buffer far larger than
+// the runs now need is given back, so a server worker does not hold on to the
+// peak of one large job.
+//
+// Nothing allocated from the arena may outlive the next reset().
+class RunArena {
+public:
+    RunArena() { reset(0); }
+    RunArena(const RunArena&) = delete;
+    RunArena& operator=(const RunArena&) = delete;
+
+    // Ends the previous run and prepares for one needing about `bytes`. The
+    // buffer covers both `bytes` and what the previous run actually used,
+    // including what it had to take from the heap because its plan
+    // underestimated it. It grows as needed and shrinks once that need falls
+    // below 1/kShrinkRatio of it.
+    void reset(size_t bytes);
+
+    static const size_t kShrinkRatio = 4;
+
+    // Bump allocation, for state sized once (trajectories)
+    std::pmr::memory_resource* buffer() { return &*monotonic; }
+    // Size-class pools, for state that grows in steps (event buffers)
+    std::pmr::memory_resource* pool() { return &*pools; }
+
+    size_t capacity() const { return buffer_bytes; }
+    // Heap bytes the current run has needed beyond the buffer so far
+    size_t overflow() const { return heap.peak; }
+
+private:
+    // Heap behind the buffer; counts what spills over into it
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        size_t allocated = 0;
+        size_t peak = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    std::unique_ptr<std::byte[]> storage;
+    size_t buffer_bytes = 0;
+    OverflowResource heap;
+    std::optional<std::pmr::monotonic_buffer_resource> monotonic;
+    std::optional<std::pmr::unsynchronized_pool_resource> pools;
+};
+
+#endif // RUN_ARENA_H
@@ -0,0 +1,68 @@
+#include "sensitivity.h"
+#include "dual.h"
+#include "synapse.h"
+#include <fstream>
+#include <iostream>
+
+typedef Dual<kNumSensitivityParams> SensitivityDual;
+
+const char* sensitivity_param_name(int param) {
+    switch (param) {
+        case kLearningRate: return "learning_rate";
+        case kDecayRate: return "decay_rate";
+        case kInitialWeight: return "initial_weight";
+        case kTimeStep: return "dt";
+        default: return "unknown";
+    }
+}
+
+SensitivityResult run_sensitivities(const EnsembleConfig& config) {
+    const SensitivityDual learning_rate = SensitivityDual::variable(config.learning_rate, kLearningRate);
+    const SensitivityDual decay_rate = SensitivityDual::variable(config.decay_rate, kDecayRate);
+    const SensitivityDual dt = SensitivityDual::variable(config.dt, kTimeStep);
+    const size_t steps = count_steps(config.sim_duration, config.dt);
+    const size_t replicas = config.replicas ? config.replicas : 1;
+
+    SensitivityResult result;
+    result.replicas = replicas;
+    result.final_weight = 0.0;
+    for (int p = 0; p < kNumSensitivityParams; ++p) result.gradient[p] = 0.0;
+
+    for (size_t r = 0; r < replicas; ++r) {
+        const uint64_t key = CounterRng::replica_key(config.seed, r);
+        SensitivityDual weight = SensitivityDual::variable(config.initial_weight, kInitialWeight);
+
+        for (size_t step = 0; step < steps; ++step) {
+            const uint64_t counter = static_cast<uint64_t>(step) * kDrawsPerStep;
+            double pre_activity, post_activity;
+            random_activity(CounterRng::uniform(key, counter),
+                            CounterRng::uniform(key, counter + 1),
+                            CounterRng::uniform(key, counter + 2),
+                            pre_activity, post_activity);
+            weight = hebbian_step(weight, pre_activity, post_activity, learning_rate, decay_rate, dt);
+        }
+
+        result.final_weight += weight.value;
+        for (int p = 0; p < kNumSensitivityParams; ++p) result.gradient[p] += weight.grad[p];
+    }
+
+    result.final_weight /= replicas;
+    for (int p = 0; p < kNumSensitivityParams; ++p) result.gradient[p] /= replicas;
+    return result;
+}
+
+void save_sensitivities(const SensitivityResult& result, const std::string& filepath) {
+    std::ofstream outfile(filepath);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return;
+    }
+
+    outfile << "parameter,replicas,final_weight,d_final_weight\n";
+    for (int p = 0; p < kNumSensitivityParams; ++p) {
+        outfile << sensitivity_param_name(p) << ","
+                << result.replicas << ","
+                << result.final_weight << ","
+                << result.gradient[p] << "\n";
+    }
+}
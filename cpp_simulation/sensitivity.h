@@ -0,0 +1,35 @@
+#ifndef SENSITIVITY_H
+#define SENSITIVITY_H
+
+#include "ensemble.h"
+#include <string>
+
+// Parameters the sensitivity run differentiates with respect to
+enum SensitivityParam {
+    kLearningRate = 0,
+    kDecayRate,
+    kInitialWeight,
+    kTimeStep,
+    kNumSensitivityParams
+};
+
+const char* sensitivity_param_name(int param);
+
+// Final weight and its derivative with respect to every parameter, averaged over replicas
+struct SensitivityResult {
+    size_t replicas;
+    double final_weight;
+    double gradient[kNumSensitivityParams];
+};
+
+// Forward-mode AD run: dual numbers with one tangent per parameter are pushed
+// through hebbian_step, so each replica yields all sensitivities in one pass.
+// Activity comes from the same counter-based streams as Ensemble in Monte Carlo
+// mode, so replica r here follows replica r of an ensemble with the same seed.
+// The dt sensitivity holds the step count fixed; a clamped weight contributes a
+// zero subgradient.
+SensitivityResult run_sensitivities(const EnsembleConfig& config);
+
+void save_sensitivities(const SensitivityResult& result, const std::string& filepath);
+
+#endif // SENSITIVITY_H
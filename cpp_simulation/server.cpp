@@ -0,0 +1,474 @@
+#include "server.h"
+#include "ensemble.h"
+#include "result_cache.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+std::string json_escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        if (c == '\n') {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+std::string status_line(const std::string& id, const std::string& status, const std::string& fields = "") {
+    std::string line = "{\"id\": \"" + json_escape(id) + "\", \"status\": \"" + status + "\"";
+    if (!fields.empty()) line += ", " + fields;
+    return line + "}\n";
+}
+
+// Jobs inherit the server defaults, so only malformed overrides can be missing or bad
+bool validate_numeric(const Config& config, const char* const* keys, std::string& error) {
+    for (const char* const* key = keys; *key; ++key) {
+        if (!config.has(*key)) {
+            error = std::string("missing key ") + *key;
+            return false;
+        }
+        const std::string value = config.entries().at(*key);
+        char* end = nullptr;
+        std::strtod(value.c_str(), &end);
+        if (end == value.c_str() || *end != '\0') {
+            error = std::string("invalid numeric value for ") + *key;
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* const kModelKeys[] = {"sim_duration", "dt", "learning_rate", "decay_rate", "initial_weight", nullptr};
+
+// Integer overrides the trajectory and summary jobs read, with the smallest value each accepts
+struct IntegerKey {
+    const char* key;
+    int minimum;
+};
+const IntegerKey kIntegerKeys[] = {{"ensemble_replicas", 1}, {"record_every", 1}, {"seed", 0}, {"ensemble_lanes", 4}};
+
+bool validate_integers(const Config& config, std::string& error) {
+    for (const IntegerKey& entry : kIntegerKeys) {
+        if (!config.has(entry.key)) continue;
+        int value;
+        try {
+            value = config.get_int(entry.key);
+        } catch (const ConfigError&) {
+            error = std::string("invalid integer value for ") + entry.key;
+            return false;
+        }
+        if (value < entry.minimum) {
+            error = std::string(entry.key) + " must be at least " + std::to_string(entry.minimum);
+            return false;
+        }
+    }
+    if (config.has("ensemble_lanes")) {
+        const int lanes = config.get_int("ensemble_lanes");
+        if (lanes != 4 && lanes != 8 && lanes != 16) {
+            error = "ensemble_lanes must be 4, 8 or 16";
+            return false;
+        }
+    }
+    return true;
+}
+
+EnsembleConfig job_ensemble_config(const Config& config) {
+    EnsembleConfig ens;
+    ens.sim_duration = config.get_double("sim_duration");
+    ens.dt = config.get_double("dt");
+    ens.learning_rate = config.get_double("learning_rate");
+    ens.decay_rate = config.get_double("decay_rate");
+    ens.initial_weight = config.get_double("initial_weight");
+    ens.replicas = config.has("ensemble_replicas") ? static_cast<size_t>(config.get_int("ensemble_replicas")) : 1;
+    ens.seed = config.has("seed") ? static_cast<uint64_t>(config.get_int("seed")) : 1;
+    if (config.has("record_every")) ens.record_every = static_cast<size_t>(config.get_int("record_every"));
+    return ens;
+}
+
+} // namespace
+
+// --- Connection ---
+
+bool SimulationServer::Connection::send(const std::string& text) {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    if (!open) return false;
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t n = ::send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            open = false;
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// --- SimulationServer Class Implementation ---
+
+SimulationServer::SimulationServer(const ServerOptions& options) : options(options), stopping(false) {
+    if (this->options.workers == 0) this->options.workers = std::thread::hardware_concurrency();
+    if (this->options.workers == 0) this->options.workers = 1;
+}
+
+SimulationServer::~SimulationServer() {
+    stop();
+    finish_jobs();
+    for (auto& connection : connections) {
+        if (connection->reader.joinable()) connection->reader.join();
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(options.socket_path.c_str());
+    }
+}
+
+void SimulationServer::stop() {
+    // Every job still gets its final status line: queued ones are answered here,
+    // running ones are flagged and answer themselves before finish_jobs() returns
+    std::vector<std::shared_ptr<Job>> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+        while (!queue.empty()) {
+            abandoned.push_back(queue.top());
+            active.erase(queue.top()->id);
+            queue.pop();
+        }
+        for (auto& running : active) *running.second = true;
+    }
+    job_ready.notify_all();
+    for (const auto& job : abandoned) job->connection->send(status_line(job->id, "cancelled"));
+}
+
+void SimulationServer::finish_jobs() {
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+    // Only now are the connections closed, which wakes readers blocked in recv
+    std::lock_guard<std::mutex> lock(readers_mutex);
+    for (auto& connection : connections) {
+        std::lock_guard<std::mutex> write_lock(connection->write_mutex);
+        if (connection->fd >= 0) shutdown(connection->fd, SHUT_RDWR);
+    }
+}
+
+void SimulationServer::reap_connections() {
+    std::lock_guard<std::mutex> lock(readers_mutex);
+    for (auto it = connections.begin(); it != connections.end();) {
+        if ((*it)->finished) {
+            (*it)->reader.join();
+            it = connections.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int SimulationServer::run() {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (options.socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << options.socket_path << std::endl;
+        return 1;
+    }
+    std::strncpy(address.sun_path, options.socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "Error: Could not create socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    unlink(options.socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, 64) != 0) {
+        std::cerr << "Error: Could not listen on " << options.socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    for (size_t i = 0; i < options.workers; ++i) {
+        workers.emplace_back(&SimulationServer::worker_loop, this);
+    }
+    std::cout << "Serving on " << options.socket_path << " with " << options.workers << " workers" << std::endl;
+
+    while (!stopping) {
+        reap_connections();
+        pollfd pending = {listen_fd, POLLIN, 0};
+        if (poll(&pending, 1, 200) <= 0) continue;
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        auto connection = std::make_shared<Connection>(fd);
+        std::lock_guard<std::mutex> lock(readers_mutex);
+        connections.push_back(connection);
+        connection->reader = std::thread(&SimulationServer::serve_connection, this, connection);
+    }
+    finish_jobs();
+    std::cout << "Server stopped" << std::endl;
+    return 0;
+}
+
+void SimulationServer::serve_connection(std::shared_ptr<Connection> connection) {
+    std::string buffer;
+    char chunk[4096];
+    // Runs until the client leaves or finish_jobs() shuts the socket down, so replies
+    // to jobs still running at shutdown can be delivered
+    while (true) {
+        ssize_t n = recv(connection->fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) break;
+        buffer.append(chunk, static_cast<size_t>(n));
+        size_t newline;
+        while ((newline = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+            // A mistyped control field ("id": 5) fails only its own message
+            try {
+                handle_message(line, connection);
+            } catch (const ConfigError& e) {
+                connection->send(status_line("", "error", "\"message\": \"" + json_escape(e.what()) + "\""));
+            }
+        }
+    }
+
+    // A client that goes away cancels whatever it still had queued or running.
+    // Jobs may still hold the connection, so the fd is retired under the write lock.
+    {
+        std::lock_guard<std::mutex> lock(connection->write_mutex);
+        connection->open = false;
+        close(connection->fd);
+        connection->fd = -1;
+    }
+    connection->finished = true; // the accept loop joins this thread and drops the connection
+}
+
+void SimulationServer::handle_message(const std::string& line, const std::shared_ptr<Connection>& connection) {
+    Config message;
+    try {
+        message = Config::from_string(line);
+    } catch (const ConfigError& e) {
+        connection->send(status_line("", "error", "\"message\": \"" + json_escape(e.what()) + "\""));
+        return;
+    }
+
+    if (message.has("command") && message.get_string("command") == "shutdown") {
+        connection->send("{\"status\": \"shutting down\"}\n");
+        stop();
+        return;
+    }
+    if (message.has("cancel")) {
+        std::string id = message.get_string("cancel");
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        auto it = active.find(id);
+        if (it != active.end()) *it->second = true;
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->id = message.has("id") ? message.get_string("id") : "";
+    job->kind = message.has("job") ? message.get_string("job") : "summary";
+    job->connection = connection;
+    job->cancelled = std::make_shared<std::atomic<bool>>(false);
+    job->config = options.defaults;
+    // Job-control keys stay out of the config so identical jobs share memo entries
+    for (const auto& entry : message.entries()) {
+        if (entry.first != "id" && entry.first != "priority" && entry.first != "job") job->config.copy_entry(message, entry.first);
+    }
+
+    std::string error;
+    if (job->id.empty()) error = "missing id";
+    else if (job->kind == "run" && !job->config.has("region")) error = "missing key region";
+    else if (message.has_runs()) error = "regions and sweep are not accepted in a job; send one job per run";
+    else if (!validate_numeric(job->config, kModelKeys, error)) {}
+    else if (!validate_integers(job->config, error)) {}
+    else if (message.has("priority")) {
+        const char* const priority_key[] = {"priority", nullptr};
+        validate_numeric(message, priority_key, error);
+    }
+    if (!error.empty()) {
+        connection->send(status_line(job->id, "error", "\"message\": \"" + json_escape(error) + "\""));
+        return;
+    }
+    job->priority = message.has("priority") ? message.get_int("priority") : 0;
+
+    // The id is claimed first and the job queued only after "queued" is sent, so
+    // no worker can reply "done" ahead of it; a cancel in between still applies
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (active.count(job->id)) {
+            connection->send(status_line(job->id, "error", "\"message\": \"duplicate id\""));
+            return;
+        }
+        active[job->id] = job->cancelled;
+    }
+    connection->send(status_line(job->id, "queued"));
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        // A job arriving after stop() has drained the queue is cancelled here instead
+        if (!stopping) {
+            job->sequence = next_sequence++;
+            queue.push(job);
+            queued = true;
+        } else {
+            active.erase(job->id);
+        }
+    }
+    if (!queued) {
+        connection->send(status_line(job->id, "cancelled"));
+        return;
+    }
+    job_ready.notify_one();
+}
+
+void SimulationServer::worker_loop() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            job_ready.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) return;
+            job = queue.top();
+            queue.pop();
+        }
+
+        execute(*job);
+
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        active.erase(job->id);
+    }
+}
+
+void SimulationServer::execute(Job& job) {
+    if (*job.cancelled || !job.connection->open) {
+        job.connection->send(status_line(job.id, "cancelled"));
+        return;
+    }
+    // A mistyped override fails only its own job, not the server
+    try {
+        if (job.kind == "trajectory") run_trajectory(job);
+        else if (job.kind == "summary") run_summary(job);
+        else if (job.kind == "run") run_file_job(job);
+        else job.connection->send(status_line(job.id, "error", "\"message\": \"unknown job kind\""));
+    } catch (const ConfigError& e) {
+        job.connection->send(status_line(job.id, "error", "\"message\": \"" + json_escape(e.what()) + "\""));
+    }
+}
+
+void SimulationServer::run_trajectory(Job& job) {
+    const auto start = std::chrono::steady_clock::now();
+    EnsembleConfig ens = job_ensemble_config(job.config);
+    const size_t steps = count_steps(ens.sim_duration, ens.dt);
+    const uint64_t key = CounterRng::replica_key(ens.seed, 0);
+    const std::string prefix = "{\"id\": \"" + json_escape(job.id) + "\", \"time\": ";
+
+    // Samples are batched into one write per 256 lines; cancellation is checked per batch
+    std::ostringstream batch;
+    size_t batched = 0;
+    double weight = ens.initial_weight;
+    double t = 0;
+    for (size_t step = 0; step < steps; ++step, t += ens.dt) {
+        const uint64_t counter = static_cast<uint64_t>(step) * kDrawsPerStep;
+        double pre, post;
+        random_activity(CounterRng::uniform(key, counter), CounterRng::uniform(key, counter + 1),
+                        CounterRng::uniform(key, counter + 2), pre, post);
+        weight = hebbian_step(weight, pre, post, ens.learning_rate, ens.decay_rate, ens.dt);
+        if (step % ens.record_every != 0) continue;
+
+        batch << prefix << t << ", \"pre\": " << pre << ", \"post\": " << post << ", \"weight\": " << weight << "}\n";
+        if (++batched == 256) {
+            if (*job.cancelled || !job.connection->send(batch.str())) {
+                job.connection->send(status_line(job.id, "cancelled"));
+                return;
+            }
+            batch.str("");
+            batched = 0;
+        }
+    }
+    job.connection->send(batch.str());
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::ostringstream fields;
+    fields << "\"final_weight\": " << weight << ", \"elapsed_ms\": " << ms;
+    job.connection->send(status_line(job.id, "done", fields.str()));
+}
+
+void SimulationServer::run_summary(Job& job) {
+    const auto start = std::chrono::steady_clock::now();
+    const std::string key = ResultCache::make_key(job.config);
+    std::string fields;
+    {
+        std::lock_guard<std::mutex> lock(memo_mutex);
+        auto hit = summary_memo.find(key);
+        if (hit != summary_memo.end()) fields = hit->second + ", \"cached\": true";
+    }
+
+    if (fields.empty()) {
+        // Replicas run one lane block at a time so a cancel takes effect quickly
+        EnsembleConfig ens = job_ensemble_config(job.config);
+        ens.lanes = job.config.has("ensemble_lanes") ? job.config.get_int("ensemble_lanes") : options.lanes;
+        const size_t block = static_cast<size_t>(ens.lanes);
+        double sum = 0, sum_sq = 0;
+        for (size_t first = 0; first < ens.replicas; first += block) {
+            if (*job.cancelled) {
+                job.connection->send(status_line(job.id, "cancelled"));
+                return;
+            }
+            EnsembleConfig part = ens;
+            part.replicas = ens.replicas - first < block ? ens.replicas - first : block;
+            FinalWeightSummary summary = summarize_final_weight(part, first);
+            sum += summary.mean * part.replicas;
+            sum_sq += (summary.variance * (part.replicas > 1 ? part.replicas - 1 : 0)) + summary.mean * summary.mean * part.replicas;
+        }
+        double mean = sum / ens.replicas;
+        double variance = ens.replicas > 1 ? (sum_sq - sum * mean) / (ens.replicas - 1) : 0.0;
+        std::ostringstream out;
+        out << "\"replicas\": " << ens.replicas << ", \"mean_final_weight\": " << mean
+            << ", \"var_final_weight\": " << (variance > 0 ? variance : 0.0);
+        fields = out.str();
+        std::lock_guard<std::mutex> lock(memo_mutex);
+        summary_memo[key] = fields;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::ostringstream timing;
+    timing << ", \"elapsed_ms\": " << ms;
+    job.connection->send(status_line(job.id, "done", fields + timing.str()));
+}
+
+void SimulationServer::run_file_job(Job& job) {
+    if (!options.run_files) {
+        job.connection->send(status_line(job.id, "error", "\"message\": \"file jobs not available\""));
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(file_job_mutex);
+    if (*job.cancelled || stopping) {
+        job.connection->send(status_line(job.id, "cancelled"));
+        return;
+    }
+    std::vector<std::string> outputs;
+    int status = options.run_files(job.config, outputs);
+
+    std::ostringstream fields;
+    fields << "\"outputs\": [";
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        fields << (i ? ", " : "") << "\"" << json_escape(outputs[i]) << "\"";
+    }
+    fields << "], \"elapsed_ms\": "
+           << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    job.connection->send(status_line(job.id, status == 0 ? "done" : "error", fields.str()));
+}
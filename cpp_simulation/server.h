@@ -0,0 +1,112 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "synapse.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs one file-writing job (any config "mode") and reports the files it wrote
+typedef std::function<int(const Config& job, std::vector<std::string>& outputs)> FileJobRunner;
+
+struct ServerOptions {
+    std::string socket_path;
+    size_t workers = 0;   // concurrent jobs, 0 = one per hardware thread
+    int lanes = 8;        // replicas per lane block in summary jobs (4, 8 or 16)
+    Config defaults;      // keys every job inherits unless it overrides them
+    FileJobRunner run_files;
+};
+
+// Persistent simulation daemon listening on a Unix domain socket.
+//
+// Protocol: newline-delimited JSON objects in both directions. A job is a flat
+// object with an "id", an optional "priority" (higher runs first), a "job" kind
+// and any config keys overriding the server defaults:
+//   "trajectory"  streams {"id","time","pre","post","weight"} samples of one seeded replica
+//   "summary"     replies with the final-weight mean and variance over ensemble_replicas
+//   "run"         runs a full config mode, writing its files (through the result cache);
+//                 one at a time, since runs of a region share output paths, and
+//                 without "regions" or "sweep" (send one job per run instead)
+// {"cancel": "<id>"} cancels a queued job, or a running trajectory or summary job
+// ("run" jobs cannot be interrupted once started); {"command": "shutdown"} stops
+// the server, cancelling queued jobs and running trajectory and summary jobs (a
+// running "run" job finishes first). Every job ends with one
+// {"id", "status": "done" | "cancelled" | "error"} line.
+// Worker threads and the summary memo live as long as the server, so a small
+// job costs only its own simulation time.
+class SimulationServer {
+public:
+    explicit SimulationServer(const ServerOptions& options);
+    ~SimulationServer();
+
+    // Binds the socket and serves until a shutdown command; returns 0 on a clean stop
+    int run();
+    void stop();
+
+private:
+    struct Connection {
+        int fd; // -1 once the reader has closed it; guarded by write_mutex
+        std::mutex write_mutex;
+        std::atomic<bool> open;
+        std::atomic<bool> finished; // reader thread has returned and can be joined
+        std::thread reader;
+        explicit Connection(int fd) : fd(fd), open(true), finished(false) {}
+        bool send(const std::string& text);
+    };
+
+    struct Job {
+        std::string id;
+        std::string kind;
+        int priority;
+        uint64_t sequence;
+        Config config;
+        std::shared_ptr<Connection> connection;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+
+    struct JobOrder {
+        bool operator()(const std::shared_ptr<Job>& a, const std::shared_ptr<Job>& b) const {
+            if (a->priority != b->priority) return a->priority < b->priority;
+            return a->sequence > b->sequence; // FIFO within a priority
+        }
+    };
+
+    void serve_connection(std::shared_ptr<Connection> connection);
+    void reap_connections();
+    void finish_jobs();
+    void handle_message(const std::string& line, const std::shared_ptr<Connection>& connection);
+    void worker_loop();
+    void execute(Job& job);
+    void run_trajectory(Job& job);
+    void run_summary(Job& job);
+    void run_file_job(Job& job);
+
+    ServerOptions options;
+    int listen_fd = -1;
+    std::atomic<bool> stopping;
+
+    std::mutex queue_mutex;
+    std::condition_variable job_ready;
+    std::priority_queue<std::shared_ptr<Job>, std::vector<std::shared_ptr<Job>>, JobOrder> queue;
+    std::map<std::string, std::shared_ptr<std::atomic<bool>>> active; // id -> cancel flag
+    uint64_t next_sequence = 0;
+
+    std::mutex file_job_mutex; // file jobs write fixed per-region paths and cache staging dirs
+
+    std::mutex memo_mutex;
+    std::map<std::string, std::string> summary_memo; // config hash -> reply fields
+
+    std::vector<std::thread> workers;
+    std::mutex readers_mutex;
+    std::vector<std::shared_ptr<Connection>> connections;
+};
+
+#endif // SERVER_H
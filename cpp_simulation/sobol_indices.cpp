@@ -0,0 +1,174 @@
+#include "sobol_indices.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// Jansen (1999) / Saltelli (2010) estimators over the selected rows
+void estimate_indices(const std::vector<double>& f_a, const std::vector<double>& f_b,
+                      const std::vector<std::vector<double>>& f_ab, const std::vector<size_t>& rows,
+                      std::vector<double>& first_order, std::vector<double>& total) {
+    const size_t d = f_ab.size();
+    const double n = static_cast<double>(rows.size());
+
+    double sum = 0, sum_sq = 0;
+    for (size_t j : rows) {
+        sum += f_a[j] + f_b[j];
+        sum_sq += f_a[j] * f_a[j] + f_b[j] * f_b[j];
+    }
+    double mean = sum / (2 * n);
+    double variance = sum_sq / (2 * n) - mean * mean;
+
+    first_order.assign(d, 0.0);
+    total.assign(d, 0.0);
+    if (variance <= 0) return;
+
+    for (size_t i = 0; i < d; ++i) {
+        double s1 = 0, st = 0;
+        for (size_t j : rows) {
+            s1 += f_b[j] * (f_ab[i][j] - f_a[j]);
+            double diff = f_a[j] - f_ab[i][j];
+            st += diff * diff;
+        }
+        first_order[i] = s1 / n / variance;
+        total[i] = 0.5 * st / n / variance;
+    }
+}
+
+double percentile(std::vector<double>& values, double q) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(q * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+} // namespace
+
+std::vector<SobolIndex> compute_sobol_indices(const SobolConfig& config, ThreadPool& pool, std::vector<SobolRun>* runs) {
+    const size_t d = config.ranges.size();
+    const size_t n = config.base_samples;
+    const size_t total_runs = n * (d + 2);
+
+    // Design layout: rows [0, n) are A, [n, 2n) are B, then n rows of A_B^(i) per parameter
+    std::vector<double> design(total_runs * d);
+    const uint64_t design_key = CounterRng::replica_key(config.base.seed, 0x5A17E11Eu);
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t i = 0; i < d; ++i) {
+            const ParameterRange& range = config.ranges[i];
+            double u_a = OwenSobol::uniform(design_key, i, static_cast<uint32_t>(j));
+            double u_b = OwenSobol::uniform(design_key, d + i, static_cast<uint32_t>(j));
+            design[j * d + i] = range.low + u_a * (range.high - range.low);
+            design[(n + j) * d + i] = range.low + u_b * (range.high - range.low);
+        }
+    }
+    for (size_t k = 0; k < d; ++k) {
+        for (size_t j = 0; j < n; ++j) {
+            double* row = &design[((2 + k) * n + j) * d];
+            std::copy(&design[j * d], &design[j * d] + d, row);
+            row[k] = design[(n + j) * d + k];
+        }
+    }
+
+    // Every run uses the same replica streams (common random numbers), so output
+    // differences come from the parameters rather than from activity noise.
+    std::vector<double> output(total_runs);
+    size_t grain = total_runs / (pool.size() * 16) + 1;
+    pool.parallel_for(total_runs, grain, [&](size_t begin, size_t end, size_t) {
+        for (size_t r = begin; r < end; ++r) {
+            EnsembleConfig run = config.base;
+            for (size_t i = 0; i < d; ++i) {
+                set_parameter(run, config.ranges[i].name, design[r * d + i]);
+            }
+            output[r] = summarize_final_weight(run).mean;
+        }
+    });
+
+    if (runs) {
+        runs->resize(total_runs);
+        for (size_t r = 0; r < total_runs; ++r) {
+            (*runs)[r].params.assign(&design[r * d], &design[r * d] + d);
+            (*runs)[r].final_weight = output[r];
+        }
+    }
+
+    std::vector<double> f_a(output.begin(), output.begin() + n);
+    std::vector<double> f_b(output.begin() + n, output.begin() + 2 * n);
+    std::vector<std::vector<double>> f_ab(d);
+    for (size_t k = 0; k < d; ++k) {
+        f_ab[k].assign(output.begin() + (2 + k) * n, output.begin() + (3 + k) * n);
+    }
+
+    std::vector<size_t> rows(n);
+    for (size_t j = 0; j < n; ++j) rows[j] = j;
+    std::vector<double> first_order, total;
+    estimate_indices(f_a, f_b, f_ab, rows, first_order, total);
+
+    // Bootstrap over design rows; each resample is independent, so spread them over the pool
+    std::vector<std::vector<double>> boot_first(d, std::vector<double>(config.bootstrap));
+    std::vector<std::vector<double>> boot_total(d, std::vector<double>(config.bootstrap));
+    const uint64_t boot_key = CounterRng::replica_key(config.base.seed, 0xB0075u);
+    pool.parallel_for(config.bootstrap, 1, [&](size_t begin, size_t end, size_t) {
+        std::vector<size_t> sample(n);
+        std::vector<double> s1, st;
+        for (size_t b = begin; b < end; ++b) {
+            for (size_t j = 0; j < n; ++j) {
+                double u = CounterRng::uniform(CounterRng::mix(boot_key + b), j);
+                sample[j] = static_cast<size_t>(u * n);
+            }
+            estimate_indices(f_a, f_b, f_ab, sample, s1, st);
+            for (size_t i = 0; i < d; ++i) {
+                boot_first[i][b] = s1[i];
+                boot_total[i][b] = st[i];
+            }
+        }
+    });
+
+    const double tail = (1.0 - config.confidence) / 2;
+    std::vector<SobolIndex> indices(d);
+    for (size_t i = 0; i < d; ++i) {
+        SobolIndex& index = indices[i];
+        index.name = config.ranges[i].name;
+        index.first_order = first_order[i];
+        index.total = total[i];
+        index.first_order_low = percentile(boot_first[i], tail);
+        index.first_order_high = percentile(boot_first[i], 1.0 - tail);
+        index.total_low = percentile(boot_total[i], tail);
+        index.total_high = percentile(boot_total[i], 1.0 - tail);
+    }
+    return indices;
+}
+
+void save_sobol_indices(const std::vector<SobolIndex>& indices, const std::string& filepath) {
+    std::ofstream outfile(filepath);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return;
+    }
+
+    outfile << "parameter,first_order,first_order_low,first_order_high,total_order,total_order_low,total_order_high\n";
+    for (const auto& index : indices) {
+        outfile << index.name << ","
+                << index.first_order << ","
+                << index.first_order_low << ","
+                << index.first_order_high << ","
+                << index.total << ","
+                << index.total_low << ","
+                << index.total_high << "\n";
+    }
+}
+
+void save_sobol_runs(const SobolConfig& config, const std::vector<SobolRun>& runs, const std::string& filepath) {
+    std::ofstream outfile(filepath);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return;
+    }
+
+    for (const auto& range : config.ranges) outfile << range.name << ",";
+    outfile << "final_weight\n";
+    for (const auto& run : runs) {
+        for (double value : run.params) outfile << value << ",";
+        outfile << run.final_weight << "\n";
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SOBOL_INDICES_H
+#define SOBOL_INDICES_H
+
+#include "ensemble.h"
+#include "thread_pool.h"
+#include <string>
+#include <vector>
+
+struct SobolConfig {
+    EnsembleConfig base;                // fixed parameters, replicas and seed per run
+    std::vector<ParameterRange> ranges; // parameters that vary
+    size_t base_samples = 1024;         // N: rows of each Saltelli matrix
+    size_t bootstrap = 200;             // resamples for the confidence intervals
+    double confidence = 0.95;
+};
+
+// First-order and total Sobol index of one parameter with bootstrap intervals
+struct SobolIndex {
+    std::string name;
+    double first_order, first_order_low, first_order_high;
+    double total, total_low, total_high;
+};
+
+// One evaluated design point: parameter values in `ranges` order and the output
+struct SobolRun {
+    std::vector<double> params;
+    double final_weight;
+};
+
+// Saltelli sampling with Jansen estimators. Builds the A, B and A_B^(i) matrices
+// (N * (d + 2) runs) from scrambled Sobol points, runs them in parallel batches
+// on the pool, and bootstraps the row set for confidence intervals. Each run's
+// output is the mean final weight over base.replicas replicas.
+std::vector<SobolIndex> compute_sobol_indices(const SobolConfig& config, ThreadPool& pool,
+                                              std::vector<SobolRun>* runs = nullptr);
+
+void save_sobol_indices(const std::vector<SobolIndex>& indices, const std::string& filepath);
+void save_sobol_runs(const SobolConfig& config, const std::vector<SobolRun>& runs, const std::string& filepath);
+
+#endif // SOBOL_INDICES_H
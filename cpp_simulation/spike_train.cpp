@@ -0,0 +1,214 @@
+#include "spike_train.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kSpikeMagic[8] = {'Q', 'D', 'S', 'P', 'K', '1', '\0', '\0'};
+const uint32_t kSpikeVersion = 1;
+const uint32_t kSpikeChannels = 2;
+const size_t kHeaderBytes = 24;
+const size_t kChannelEntryBytes = 32;
+
+// Pages requested ahead of a cursor, and how far it runs before pages behind it are released
+const size_t kPrefetchWindow = size_t(4) << 20;
+const size_t kReleaseChunk = size_t(1) << 20;
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+template <typename T>
+void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+// Sorted tick counts of one channel; spikes before time 0 are dropped
+std::vector<uint64_t> to_ticks(const std::vector<double>& spikes, double tick) {
+    std::vector<uint64_t> ticks;
+    ticks.reserve(spikes.size());
+    for (double time : spikes) {
+        if (time >= 0) ticks.push_back(static_cast<uint64_t>(std::llround(time / tick)));
+    }
+    std::sort(ticks.begin(), ticks.end());
+    return ticks;
+}
+
+} // namespace
+
+bool write_spike_train(const std::string& filepath, double tick, const std::vector<double>& pre_spikes,
+                       const std::vector<double>& post_spikes) {
+    if (!(tick > 0)) {
+        std::cerr << "Error: Spike-train tick must be positive." << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> encoded[kSpikeChannels];
+    std::vector<uint64_t> ticks[kSpikeChannels] = {to_ticks(pre_spikes, tick), to_ticks(post_spikes, tick)};
+    for (uint32_t c = 0; c < kSpikeChannels; ++c) {
+        uint64_t previous = 0;
+        for (uint64_t t : ticks[c]) {
+            put_varint(encoded[c], t - previous);
+            previous = t;
+        }
+    }
+
+    std::string header(kSpikeMagic, sizeof(kSpikeMagic));
+    put(header, kSpikeVersion);
+    put(header, kSpikeChannels);
+    put(header, tick);
+    uint64_t offset = kHeaderBytes + kSpikeChannels * kChannelEntryBytes;
+    for (uint32_t c = 0; c < kSpikeChannels; ++c) {
+        put(header, offset);
+        put(header, static_cast<uint64_t>(encoded[c].size()));
+        put(header, static_cast<uint64_t>(ticks[c].size()));
+        put(header, ticks[c].empty() ? uint64_t(0) : ticks[c].back());
+        offset += encoded[c].size();
+    }
+
+    std::ofstream outfile(filepath, std::ios::binary);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << filepath << std::endl;
+        return false;
+    }
+    outfile.write(header.data(), header.size());
+    for (uint32_t c = 0; c < kSpikeChannels; ++c) {
+        outfile.write(reinterpret_cast<const char*>(encoded[c].data()), encoded[c].size());
+    }
+    return static_cast<bool>(outfile);
+}
+
+// --- MappedSpikeTrain Class Implementation ---
+
+MappedSpikeTrain::MappedSpikeTrain(const std::string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open spike-train file " << filepath << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < kHeaderBytes + kSpikeChannels * kChannelEntryBytes) {
+        std::cerr << "Error: " << filepath << " is too small to be a spike-train file." << std::endl;
+        close(fd);
+        return;
+    }
+    size = static_cast<size_t>(info.st_size);
+    void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Error: Could not map spike-train file " << filepath << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(memory);
+
+    bool valid = std::memcmp(bytes, kSpikeMagic, sizeof(kSpikeMagic)) == 0 && get<uint32_t>(bytes + 8) == kSpikeVersion &&
+                 get<uint32_t>(bytes + 12) == kSpikeChannels;
+    tick = get<double>(bytes + 16);
+    valid = valid && tick > 0;
+    for (uint32_t c = 0; valid && c < kSpikeChannels; ++c) {
+        const uint8_t* entry = bytes + kHeaderBytes + c * kChannelEntryBytes;
+        uint64_t offset = get<uint64_t>(entry), length = get<uint64_t>(entry + 8);
+        if (offset > size || length > size - offset) {
+            valid = false;
+            break;
+        }
+        Cursor& cursor = cursors[c];
+        cursor.pos = cursor.released = cursor.prefetched = bytes + offset;
+        cursor.end = bytes + offset + length;
+        cursor.spikes = cursor.undecoded = static_cast<size_t>(get<uint64_t>(entry + 16));
+        last_time = std::max(last_time, static_cast<double>(get<uint64_t>(entry + 24)) * tick);
+    }
+    if (!valid) {
+        std::cerr << "Error: " << filepath << " is not a valid spike-train file." << std::endl;
+        munmap(memory, size);
+        return;
+    }
+
+    data = static_cast<uint8_t*>(memory);
+    madvise(data, size, MADV_SEQUENTIAL);
+    for (Cursor& cursor : cursors) {
+        manage_pages(cursor);
+        advance(cursor);
+    }
+}
+
+MappedSpikeTrain::~MappedSpikeTrain() {
+    if (data) munmap(data, size);
+}
+
+// Decodes the next spike of a channel into `ticks`; false once the channel is exhausted
+bool MappedSpikeTrain::advance(Cursor& cursor) {
+    cursor.pending = false;
+    if (cursor.undecoded == 0) return false;
+
+    uint64_t gap = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (cursor.pos >= cursor.end) {
+            std::cerr << "Error: Spike-train channel ends early; ignoring its remaining spikes." << std::endl;
+            cursor.undecoded = 0;
+            return false;
+        }
+        uint8_t byte = *cursor.pos++;
+        gap |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) break;
+    }
+    cursor.ticks += gap;
+    cursor.pending = true;
+    --cursor.undecoded;
+    if (cursor.pos >= cursor.next_check) manage_pages(cursor);
+    return true;
+}
+
+// Keeps a window of pages ahead of the cursor requested and drops the ones it has passed
+void MappedSpikeTrain::manage_pages(Cursor& cursor) {
+    static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto page_floor = [this](const uint8_t* p) { return data + (size_t(p - data) / page) * page; };
+
+    if (cursor.prefetched < cursor.end && cursor.prefetched - cursor.pos < static_cast<ptrdiff_t>(kPrefetchWindow / 2)) {
+        const uint8_t* from = page_floor(std::max(cursor.pos, cursor.prefetched));
+        const uint8_t* to = cursor.end - from > static_cast<ptrdiff_t>(kPrefetchWindow) ? from + kPrefetchWindow : cursor.end;
+        madvise(const_cast<uint8_t*>(from), to - from, MADV_WILLNEED);
+        cursor.prefetched = to;
+    }
+    const uint8_t* behind = page_floor(cursor.pos);
+    const uint8_t* start = page_floor(cursor.released);
+    if (behind - start >= static_cast<ptrdiff_t>(kReleaseChunk)) {
+        madvise(const_cast<uint8_t*>(start), behind - start, MADV_DONTNEED);
+        cursor.released = behind;
+    }
+    cursor.next_check = cursor.end - cursor.pos > static_cast<ptrdiff_t>(kReleaseChunk / 4) ? cursor.pos + kReleaseChunk / 4
+                                                                                          : cursor.end;
+}
+
+bool MappedSpikeTrain::spiked(Cursor& cursor, double t, double dt) {
+    bool fired = false;
+    while (cursor.pending && static_cast<double>(cursor.ticks) * tick < t + dt) {
+        fired = true;
+        advance(cursor);
+    }
+    return fired;
+}
+
+void MappedSpikeTrain::next(double t, double dt, double& pre_activity, double& post_activity) {
+    pre_activity = spiked(cursors[0], t, dt) ? 1.0 : 0.0;
+    post_activity = spiked(cursors[1], t, dt) ? 1.0 : 0.0;
+}
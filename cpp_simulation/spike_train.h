@@ -0,0 +1,73 @@
+#ifndef SPIKE_TRAIN_H
+#define SPIKE_TRAIN_H
+
+#include "synapse.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Recorded spike trains as simulation input. A spike-train file holds the
+// sorted spike times of the pre- and post-synaptic channel as integer ticks,
+// each stored as the LEB128 varint of its gap to the previous spike, so a
+// recording costs one or two bytes per spike.
+//
+// File layout (native-endian):
+//   offset  size  field
+//        0     8  magic "QDSPK1\0\0"
+//        8     4  version (uint32, 1)
+//       12     4  channels (uint32, 2: pre, post)
+//       16     8  tick (double, simulation time units per tick)
+//       24     -  channels x {uint64 offset, uint64 bytes, uint64 spikes,
+//                 uint64 last spike tick}, then each channel's varint gaps
+
+// Writes spike times (simulation time units, any order) rounded to `tick`;
+// returns false on I/O error or an invalid tick
+bool write_spike_train(const std::string& filepath, double tick, const std::vector<double>& pre_spikes,
+                       const std::vector<double>& post_spikes);
+
+// Replays a spike-train file through Simulation::run. The file is memory-mapped
+// and decoded as the run advances; pages ahead of each channel's cursor are
+// requested from the kernel a window early and pages behind it are released,
+// so hours of recording replay in a small, fixed amount of RAM.
+class MappedSpikeTrain : public ActivitySource {
+public:
+    // Maps `filepath`; is_open() reports whether it is a valid spike-train file
+    explicit MappedSpikeTrain(const std::string& filepath);
+    ~MappedSpikeTrain();
+    MappedSpikeTrain(const MappedSpikeTrain&) = delete;
+    MappedSpikeTrain& operator=(const MappedSpikeTrain&) = delete;
+
+    bool is_open() const { return data != nullptr; }
+    // Activity is 1 if the channel spiked at least once in [t, t + dt)
+    void next(double t, double dt, double& pre_activity, double& post_activity) override;
+
+    size_t num_spikes(size_t channel) const { return cursors[channel].spikes; }
+    // Time of the last recorded spike over both channels
+    double end_time() const { return last_time; }
+
+private:
+    struct Cursor {
+        const uint8_t* pos = nullptr;
+        const uint8_t* end = nullptr;
+        const uint8_t* released = nullptr; // pages before this were handed back
+        const uint8_t* prefetched = nullptr; // pages before this were requested
+        const uint8_t* next_check = nullptr; // position of the next page bookkeeping
+        uint64_t ticks = 0; // time of the pending spike
+        bool pending = false;
+        size_t spikes = 0;
+        size_t undecoded = 0;
+    };
+
+    bool advance(Cursor& cursor);
+    bool spiked(Cursor& cursor, double t, double dt);
+    void manage_pages(Cursor& cursor);
+
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    double tick = 0;
+    double last_time = 0;
+    Cursor cursors[2];
+};
+
+#endif // SPIKE_TRAIN_H
@@ -0,0 +1,198 @@
+#include "surrogate.h"
+#include "ensemble.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// --- Sweep Table ---
+
+int SweepTable::column_index(const std::string& name) const {
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i] == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool read_sweep_table(const std::string& filepath, SweepTable& table) {
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open sweep table " << filepath << std::endl;
+        return false;
+    }
+
+    std::string line, cell;
+    if (!std::getline(file, line)) return false;
+    std::stringstream header(line);
+    while (std::getline(header, cell, ',')) table.columns.push_back(cell);
+
+    size_t line_number = 1;
+    while (std::getline(file, line)) {
+        ++line_number;
+        if (line.empty()) continue;
+        std::vector<double> row;
+        std::stringstream values(line);
+        while (std::getline(values, cell, ',')) {
+            try {
+                row.push_back(std::stod(cell));
+            } catch (const std::exception&) {
+                std::cerr << "Error: Non-numeric value '" << cell << "' in " << filepath << " line " << line_number << std::endl;
+                return false;
+            }
+        }
+        if (row.size() != table.columns.size()) {
+            std::cerr << "Error: Wrong column count in " << filepath << " line " << line_number << std::endl;
+            return false;
+        }
+        table.rows.push_back(row);
+    }
+    return true;
+}
+
+// --- Surrogate Class Implementation ---
+
+Surrogate::Surrogate(size_t features, double lengthscale, double ridge, uint64_t seed)
+    : features(features), lengthscale(lengthscale), ridge(ridge), seed(seed) {}
+
+void Surrogate::feature_map(const std::vector<double>& x, std::vector<double>& phi) const {
+    const size_t d = inputs.size();
+    const double scale = std::sqrt(2.0 / features);
+    phi.resize(features);
+    for (size_t k = 0; k < features; ++k) {
+        double projection = phase[k];
+        for (size_t i = 0; i < d; ++i) {
+            projection += frequency[k * d + i] * (x[i] - low[i]) / span[i];
+        }
+        phi[k] = scale * std::cos(projection);
+    }
+}
+
+bool Surrogate::fit(const SweepTable& table, const std::vector<std::string>& input_names, const std::string& output) {
+    inputs = input_names;
+    const size_t d = inputs.size();
+    const size_t n = table.rows.size();
+    std::vector<int> columns;
+    for (const auto& name : inputs) columns.push_back(table.column_index(name));
+    int output_column = table.column_index(output);
+    if (output_column < 0 || n < 2) return false;
+    for (int column : columns) {
+        if (column < 0) return false;
+    }
+
+    // Scale each input to the training box
+    low.assign(d, INFINITY);
+    span.assign(d, 0.0);
+    std::vector<double> high(d, -INFINITY);
+    for (const auto& row : table.rows) {
+        for (size_t i = 0; i < d; ++i) {
+            low[i] = std::min(low[i], row[columns[i]]);
+            high[i] = std::max(high[i], row[columns[i]]);
+        }
+    }
+    for (size_t i = 0; i < d; ++i) span[i] = high[i] > low[i] ? high[i] - low[i] : 1.0;
+
+    // Frequencies ~ N(0, 1 / lengthscale^2) and phases ~ U(0, 2 pi) give an RBF kernel
+    frequency.resize(features * d);
+    phase.resize(features);
+    const uint64_t key = CounterRng::replica_key(seed, 0x5E77u);
+    uint64_t counter = 0;
+    for (size_t k = 0; k < features; ++k) {
+        for (size_t i = 0; i < d; ++i) {
+            double u1 = CounterRng::uniform(key, counter++);
+            double u2 = CounterRng::uniform(key, counter++);
+            frequency[k * d + i] = std::sqrt(-2.0 * std::log(1.0 - u1)) * std::cos(2.0 * M_PI * u2) / lengthscale;
+        }
+        phase[k] = 2.0 * M_PI * CounterRng::uniform(key, counter++);
+    }
+
+    offset = 0;
+    for (const auto& row : table.rows) offset += row[output_column];
+    offset /= n;
+
+    // Normal equations (Phi^T Phi + ridge I) w = Phi^T (y - offset)
+    const size_t m = features;
+    std::vector<double> gram(m * m, 0.0), rhs(m, 0.0), phi;
+    std::vector<double> x(d);
+    for (const auto& row : table.rows) {
+        for (size_t i = 0; i < d; ++i) x[i] = row[columns[i]];
+        feature_map(x, phi);
+        double target = row[output_column] - offset;
+        for (size_t a = 0; a < m; ++a) {
+            rhs[a] += phi[a] * target;
+            for (size_t b = 0; b <= a; ++b) gram[a * m + b] += phi[a] * phi[b];
+        }
+    }
+    for (size_t a = 0; a < m; ++a) gram[a * m + a] += ridge;
+
+    // Cholesky factor, lower triangle
+    cholesky.assign(m * m, 0.0);
+    for (size_t a = 0; a < m; ++a) {
+        for (size_t b = 0; b <= a; ++b) {
+            double sum = gram[a * m + b];
+            for (size_t k = 0; k < b; ++k) sum -= cholesky[a * m + k] * cholesky[b * m + k];
+            if (a == b) {
+                if (sum <= 0) return false;
+                cholesky[a * m + a] = std::sqrt(sum);
+            } else {
+                cholesky[a * m + b] = sum / cholesky[b * m + b];
+            }
+        }
+    }
+
+    // Forward then backward substitution
+    coefficient = rhs;
+    for (size_t a = 0; a < m; ++a) {
+        for (size_t k = 0; k < a; ++k) coefficient[a] -= cholesky[a * m + k] * coefficient[k];
+        coefficient[a] /= cholesky[a * m + a];
+    }
+    for (size_t a = m; a-- > 0;) {
+        for (size_t k = a + 1; k < m; ++k) coefficient[a] -= cholesky[k * m + a] * coefficient[k];
+        coefficient[a] /= cholesky[a * m + a];
+    }
+
+    // Noise variance from the residuals, corrected for the fitted degrees of freedom
+    double residual_sq = 0;
+    for (const auto& row : table.rows) {
+        for (size_t i = 0; i < d; ++i) x[i] = row[columns[i]];
+        feature_map(x, phi);
+        double prediction = offset;
+        for (size_t k = 0; k < m; ++k) prediction += coefficient[k] * phi[k];
+        double residual = row[output_column] - prediction;
+        residual_sq += residual * residual;
+    }
+    // The ridge is the prior noise-to-signal ratio, so ridge * Var(y) is the noise
+    // the prior expects. It bounds the estimate from below: with no more rows than
+    // features the fit interpolates and the residuals say nothing about the noise,
+    // and the model variance must still grow back to Var(y) away from the data.
+    double target_variance = 0;
+    for (const auto& row : table.rows) target_variance += (row[output_column] - offset) * (row[output_column] - offset);
+    target_variance /= n - 1;
+    const double prior_noise = ridge * target_variance;
+    noise_variance = n > m ? std::max(residual_sq / static_cast<double>(n - m), prior_noise) : prior_noise;
+    return true;
+}
+
+SurrogatePrediction Surrogate::predict(const std::vector<double>& x) const {
+    std::vector<double> phi;
+    feature_map(x, phi);
+    const size_t m = features;
+
+    SurrogatePrediction prediction;
+    prediction.mean = offset;
+    for (size_t k = 0; k < m; ++k) prediction.mean += coefficient[k] * phi[k];
+
+    // Posterior covariance of the weights is noise * A^-1, so the model variance
+    // at x is noise * |L^-1 phi|^2
+    std::vector<double> v(phi);
+    double quad = 0;
+    for (size_t a = 0; a < m; ++a) {
+        for (size_t k = 0; k < a; ++k) v[a] -= cholesky[a * m + k] * v[k];
+        v[a] /= cholesky[a * m + a];
+        quad += v[a] * v[a];
+    }
+    double model_variance = noise_variance * quad;
+    prediction.model_std = std::sqrt(model_variance);
+    prediction.variance = noise_variance + model_variance;
+    return prediction;
+}
@@ -0,0 +1,58 @@
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Table of numeric columns read from a sweep summary CSV (header row required)
+struct SweepTable {
+    std::vector<std::string> columns;
+    std::vector<std::vector<double>> rows;
+
+    int column_index(const std::string& name) const;
+};
+
+// Reads a numeric CSV; returns false if the file cannot be opened or parsed
+bool read_sweep_table(const std::string& filepath, SweepTable& table);
+
+struct SurrogatePrediction {
+    double mean;          // predicted final weight
+    double variance;      // predictive variance: run-to-run noise plus model uncertainty
+    double model_std;     // model (epistemic) part only; large away from the training data
+};
+
+// Random Fourier features ridge regression: inputs are scaled to the training
+// box, mapped through D random cosine features approximating an RBF kernel,
+// and fitted by Bayesian ridge regression. Prediction is one D x d feature map
+// plus one triangular solve, so it answers in microseconds.
+class Surrogate {
+public:
+    Surrogate(size_t features = 256, double lengthscale = 0.3, double ridge = 1e-3, uint64_t seed = 1);
+
+    // Fits on `inputs` columns of the table, predicting the `output` column
+    bool fit(const SweepTable& table, const std::vector<std::string>& inputs, const std::string& output);
+    SurrogatePrediction predict(const std::vector<double>& x) const;
+
+    const std::vector<std::string>& get_inputs() const { return inputs; }
+    double get_noise_variance() const { return noise_variance; }
+
+private:
+    void feature_map(const std::vector<double>& x, std::vector<double>& phi) const;
+
+    size_t features;
+    double lengthscale;
+    double ridge;
+    uint64_t seed;
+
+    std::vector<std::string> inputs;
+    std::vector<double> low, span;  // input scaling to [0, 1]
+    std::vector<double> frequency;  // features x inputs
+    std::vector<double> phase;
+    std::vector<double> coefficient;
+    std::vector<double> cholesky;   // lower factor of Phi^T Phi + ridge * I
+    double offset = 0;
+    double noise_variance = 0;
+};
+
+#endif // SURROGATE_H
@@ -1,104 +1,266 @@
 #include "synapse.h"
+#include "live_stream.h"
 #include <iostream>
 #include <fstream>
 #include <random>
 #include <cmath>
+#include <cctype>
 #include <sstream> // Required for std::stringstream
 #include <stdexcept> // Required for std::stod, std::stoi
 
+namespace {
+
+std::string position(const std::string& source, const JsonValue& value) {
+    return source + ": line " + std::to_string(value.line) + ", column " + std::to_string(value.column);
+}
+
+// Whether `word` survives the text form as one token: compile_protocol splits
+// blocks on ';', settings on whitespace and each setting on its first '='
+bool protocol_token(const std::string& word, bool setting_value) {
+    if (word.empty()) return false;
+    for (char c : word) {
+        if (std::isspace(static_cast<unsigned char>(c)) || c == ';' || (c == '=' && !setting_value)) return false;
+    }
+    return true;
+}
+
+// A protocol written as JSON, one object per block ({"block": "train", "pulses": 50}),
+// turned into the text form compile_protocol reads
+std::string protocol_text(const JsonValue& value, const std::string& source) {
+    std::vector<const JsonValue*> blocks;
+    if (value.is_array()) {
+        for (const auto& item : value.items) blocks.push_back(&item);
+    } else {
+        blocks.push_back(&value);
+    }
+    std::string text;
+    for (const JsonValue* block : blocks) {
+        const JsonValue* kind = block->is_object() ? block->find("block") : nullptr;
+        if (!kind || kind->type != JsonValue::Type::String) {
+            throw ConfigError(position(source, *block) + ": each protocol block must be an object with a \"block\" string");
+        }
+        if (!protocol_token(kind->text, false)) {
+            throw ConfigError(position(source, *kind) + ": protocol block name '" + kind->text +
+                              "' must be one word without ';' or '='");
+        }
+        if (!text.empty()) text += "; ";
+        text += kind->text;
+        for (const auto& setting : block->members) {
+            if (setting.first == "block") continue;
+            const JsonValue& v = setting.second;
+            if (v.type != JsonValue::Type::Number && v.type != JsonValue::Type::String) {
+                throw ConfigError(position(source, v) + ": protocol setting '" + setting.first + "' is a " + v.type_name() +
+                                  ", expected a number or string");
+            }
+            if (!protocol_token(setting.first, false) || !protocol_token(v.text, true)) {
+                throw ConfigError(position(source, v) + ": protocol setting '" + setting.first + "=" + v.text +
+                                  "' must be one word without whitespace or ';'");
+            }
+            text += " " + setting.first + "=" + v.text;
+        }
+    }
+    return text;
+}
+
+} // namespace
+
 // --- Config Class Implementation ---
 
-// A corrected, simple JSON parser for a flat key-value structure.
-void Config::parse() {
+Config::Config(const std::string& config_path) : filepath(config_path) {
     std::ifstream file(filepath);
     if (!file.is_open()) {
-        std::cerr << "Error: Could not open config file: " << filepath << std::endl;
-        exit(1);
+        throw ConfigError("Could not open config file: " + filepath);
     }
 
     std::stringstream buffer;
     buffer << file.rdbuf();
-    std::string content = buffer.str();
-
-    size_t pos = 0;
-    while (true) {
-        size_t key_start = content.find('"', pos);
-        if (key_start == std::string::npos) break;
-
-        size_t key_end = content.find('"', key_start + 1);
-        if (key_end == std::string::npos) break;
-
-        std::string key = content.substr(key_start + 1, key_end - key_start - 1);
-
-        size_t colon_pos = content.find(':', key_end);
-        if (colon_pos == std::string::npos) break;
-
-        size_t value_start = content.find_first_not_of(" \t\r\n", colon_pos + 1);
-        if (value_start == std::string::npos) break;
-
-        size_t value_end;
-        std::string value;
-
-        if (content[value_start] == '"') { // String value
-            value_end = content.find('"', value_start + 1);
-            if (value_end == std::string::npos) break;
-            value = content.substr(value_start, value_end - value_start + 1);
-            pos = value_end + 1;
-        } else { // Numeric or boolean value
-            value_end = content.find_first_of(",}\n\r", value_start);
-            if (value_end == std::string::npos) break;
-            std::string raw_value = content.substr(value_start, value_end - value_start);
-            size_t last = raw_value.find_last_not_of(" \t\r\n");
-            value = raw_value.substr(0, last + 1);
-            pos = value_end;
+    parse_content(buffer.str());
+}
+
+Config Config::from_string(const std::string& content) {
+    Config config;
+    config.parse_content(content);
+    return config;
+}
+
+void Config::parse_content(const std::string& content) {
+    const std::string source = filepath.empty() ? "config" : filepath;
+    JsonValue document;
+    try {
+        document = JsonValue::parse(content);
+    } catch (const JsonError& e) {
+        throw ConfigError(source + ": " + e.what());
+    }
+    if (!document.is_object()) {
+        throw ConfigError(position(source, document) + ": the config must be a JSON object");
+    }
+
+    // "regions" and "sweep" describe several runs; expand() applies them
+    for (auto& member : document.members) {
+        if (member.first == "regions" && member.second.is_array()) {
+            for (const auto& entry : member.second.items) {
+                if (!entry.is_object()) {
+                    throw ConfigError(position(source, entry) + ": each \"regions\" entry must be an object");
+                }
+            }
+            regions = std::make_shared<const JsonValue>(std::move(member.second));
+        } else if (member.first == "sweep" && member.second.is_object()) {
+            for (const auto& axis : member.second.members) {
+                if (!axis.second.is_array() || axis.second.items.empty()) {
+                    throw ConfigError(position(source, axis.second) + ": sweep values for '" + axis.first +
+                                      "' must be a non-empty array");
+                }
+            }
+            sweep = std::make_shared<const JsonValue>(std::move(member.second));
+        } else {
+            assign(member.first, member.second);
         }
+    }
+}
+
+void Config::apply(const JsonValue& object) {
+    for (const auto& member : object.members) assign(member.first, member.second);
+}
 
-        //std::cout << "DEBUG: Found key: '" << key << "', value: '" << value << "'" << std::endl;
-        data[key] = value;
+void Config::assign(const std::string& key, const JsonValue& value) {
+    const std::string source = filepath.empty() ? "config" : filepath;
+    if (key == "protocol" && (value.is_object() || value.is_array())) {
+        data[key] = "\"" + protocol_text(value, source) + "\"";
+        typed[key] = {JsonValue::Type::String, 0.0, value.line, value.column, filepath};
+        return;
+    }
+    // No other key takes an object; one would otherwise be silently ignored
+    if (value.is_object()) {
+        throw ConfigError(position(source, value) + ": '" + key +
+                          "' is an object; only \"regions\", \"sweep\" and \"protocol\" take nested values");
     }
+    switch (value.type) {
+        case JsonValue::Type::String: data[key] = "\"" + value.text + "\""; break;
+        case JsonValue::Type::Number: data[key] = value.text; break;
+        case JsonValue::Type::Bool: data[key] = value.boolean ? "true" : "false"; break;
+        default: data[key] = value.dump(); break;
+    }
+    double number = value.type == JsonValue::Type::Number ? value.number : (value.boolean ? 1.0 : 0.0);
+    typed[key] = {value.type, number, value.line, value.column, filepath};
+}
+
+void Config::set(const std::string& key, const std::string& raw_value) {
+    data[key] = raw_value;
+    typed.erase(key);
 }
 
+void Config::copy_entry(const Config& from, const std::string& key) {
+    data[key] = from.raw(key);
+    auto found = from.typed.find(key);
+    if (found != from.typed.end()) typed[key] = found->second;
+    else typed.erase(key);
+}
 
-Config::Config(const std::string& config_path) : filepath(config_path) {
-    parse();
+const std::string& Config::raw(const std::string& key) const {
+    auto found = data.find(key);
+    if (found == data.end()) {
+        throw ConfigError("Configuration key '" + key + "' not found" + (filepath.empty() ? "." : " in " + filepath + "."));
+    }
+    return found->second;
+}
+
+ConfigError Config::type_error(const std::string& key, const TypedValue& value, const char* expected) const {
+    JsonValue kind;
+    kind.type = value.type;
+    return ConfigError("Configuration key '" + key + "' (" + (value.source.empty() ? "" : value.source + " ") + "line " +
+                       std::to_string(value.line) + ", column " + std::to_string(value.column) + ") is a " +
+                       kind.type_name() + ", expected " + expected + ".");
 }
 
 double Config::get_double(const std::string& key) const {
+    const std::string& value = raw(key);
+    auto found = typed.find(key);
+    if (found != typed.end()) {
+        if (found->second.type != JsonValue::Type::Number) throw type_error(key, found->second, "a number");
+        return found->second.number;
+    }
+    // Entries overridden with set() are only available as text
     try {
-        return std::stod(data.at(key));
-    } catch (const std::out_of_range&) {
-        std::cerr << "Error: Configuration key '" << key << "' not found." << std::endl;
-        exit(1);
-    } catch (const std::invalid_argument&) {
-        std::cerr << "Error: Invalid numeric value for key '" << key << "'." << std::endl;
-        exit(1);
+        return std::stod(value);
+    } catch (const std::exception&) {
+        throw ConfigError("Invalid numeric value for key '" + key + "'.");
     }
 }
 
 int Config::get_int(const std::string& key) const {
+    const std::string& value = raw(key);
+    auto found = typed.find(key);
+    if (found != typed.end()) {
+        const TypedValue& typed_value = found->second;
+        if (typed_value.type == JsonValue::Type::Bool) return typed_value.number != 0 ? 1 : 0;
+        if (typed_value.type != JsonValue::Type::Number || typed_value.number != std::floor(typed_value.number) ||
+            std::fabs(typed_value.number) > 2147483647.0) {
+            throw type_error(key, typed_value, "an integer");
+        }
+        return static_cast<int>(typed_value.number);
+    }
     try {
-        return std::stoi(data.at(key));
-    } catch (const std::out_of_range&) {
-        std::cerr << "Error: Configuration key '" << key << "' not found." << std::endl;
-        exit(1);
-    } catch (const std::invalid_argument&) {
-        std::cerr << "Error: Invalid integer value for key '" << key << "'." << std::endl;
-        exit(1);
+        return std::stoi(value);
+    } catch (const std::exception&) {
+        throw ConfigError("Invalid integer value for key '" + key + "'.");
     }
 }
 
 std::string Config::get_string(const std::string& key) const {
-    try {
-        std::string value = data.at(key);
-        // Remove quotes from string values
-        if (value.length() >= 2 && value.front() == '"' && value.back() == '"') {
-            return value.substr(1, value.length() - 2);
+    std::string value = raw(key);
+    auto found = typed.find(key);
+    if (found != typed.end() && found->second.type != JsonValue::Type::String) {
+        throw type_error(key, found->second, "a string");
+    }
+    // Remove quotes from string values
+    if (value.length() >= 2 && value.front() == '"' && value.back() == '"') {
+        return value.substr(1, value.length() - 2);
+    }
+    return value;
+}
+
+bool Config::has(const std::string& key) const {
+    return data.find(key) != data.end();
+}
+
+std::vector<Config> Config::expand() const {
+    Config base = *this;
+    base.regions.reset();
+    base.sweep.reset();
+
+    std::vector<Config> runs;
+    if (regions) {
+        for (const auto& entry : regions->items) {
+            Config run = base;
+            run.apply(entry);
+            runs.push_back(run);
         }
-        return value;
-    } catch (const std::out_of_range&) {
-        std::cerr << "Error: Configuration key '" << key << "' not found." << std::endl;
-        exit(1);
+    } else {
+        runs.push_back(base);
     }
+    if (!sweep) return runs;
+
+    // Cartesian product of the sweep axes; the first axis varies slowest
+    size_t combinations = 1;
+    for (const auto& axis : sweep->members) combinations *= axis.second.items.size();
+    std::vector<Config> variants;
+    variants.reserve(runs.size() * combinations);
+    for (const auto& run : runs) {
+        const std::string region = run.has("region") ? run.get_string("region") : "run";
+        for (size_t index = 0; index < combinations; ++index) {
+            Config variant = run;
+            size_t rest = index;
+            for (auto axis = sweep->members.rbegin(); axis != sweep->members.rend(); ++axis) {
+                const size_t count = axis->second.items.size();
+                variant.assign(axis->first, axis->second.items[rest % count]);
+                rest /= count;
+            }
+            variant.data["region"] = "\"" + region + "_" + std::to_string(index) + "\"";
+            variant.typed.erase("region");
+            variants.push_back(variant);
+        }
+    }
+    return variants;
 }
 
 // --- Synapse Class Implementation ---
@@ -106,50 +268,74 @@ std::string Config::get_string(const std::string& key) const {
 Synapse::Synapse(double initial_weight) : weight(initial_weight) {}
 
 void Synapse::update(double pre_activity, double post_activity, double learning_rate, double decay_rate, double dt) {
-    // Hebbian learning rule with decay: dw/dt = -alpha*w + eta*pre*post
-    double dw = (-decay_rate * weight + learning_rate * pre_activity * post_activity) * dt;
-    weight += dw;
-
-    // Clamp weight between 0 and 1
-    if (weight > 1.0) weight = 1.0;
-    if (weight < 0.0) weight = 0.0;
+    weight = hebbian_step(weight, pre_activity, post_activity, learning_rate, decay_rate, dt);
 }
 
 double Synapse::get_weight() const {
     return weight;
 }
 
+// --- RandomActivity Class Implementation ---
+
+RandomActivity::RandomActivity(unsigned int seed) : gen(seed), dis(0.0, 1.0) {}
+
+void RandomActivity::next(double, double, double& pre_activity, double& post_activity) {
+    // Generate some noisy, correlated pre- and post-synaptic activity
+    pre_activity = dis(gen) > 0.7 ? 1.0 : 0.0; // Spike with 30% probability
+    post_activity = (pre_activity > 0.5 && dis(gen) > 0.3) ? 1.0 : (dis(gen) > 0.9 ? 1.0 : 0.0); // Higher chance of post if pre fired
+}
+
 // --- Simulation Class Implementation ---
 
-Simulation::Simulation(double duration, double dt, double learning_rate, double decay_rate, double initial_weight, std::string region_name)
+Simulation::Simulation(double duration, double dt, double learning_rate, double decay_rate, double initial_weight, std::string region_name,
+                       std::pmr::memory_resource* resource)
     : sim_duration(duration),
       dt(dt),
       learning_rate(learning_rate),
       decay_rate(decay_rate),
       synapse(initial_weight),
-      region(region_name) {}
+      region(region_name),
+      results(resource) {}
 
 void Simulation::run() {
-    // Set up random number generation for activity
+    // Without an explicit source, generate random activity
     std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 1.0);
+    RandomActivity random(seeded ? seed : rd());
+    ActivitySource& source = activity ? *activity : random;
+
+    // One allocation for the whole run instead of a reallocation every doubling
+    results.reserve(results.size() + count_steps(sim_duration, dt));
 
     // Simulation loop
     for (double t = 0; t < sim_duration; t += dt) {
-        // Generate some noisy, correlated pre- and post-synaptic activity
-        double pre_activity = dis(gen) > 0.7 ? 1.0 : 0.0; // Spike with 30% probability
-        double post_activity = (pre_activity > 0.5 && dis(gen) > 0.3) ? 1.0 : (dis(gen) > 0.9 ? 1.0 : 0.0); // Higher chance of post if pre fired
+        double pre_activity, post_activity;
+        source.next(t, dt, pre_activity, post_activity);
 
         synapse.update(pre_activity, post_activity, learning_rate, decay_rate, dt);
 
         results.push_back({t, pre_activity, post_activity, synapse.get_weight(), region});
+        if (live) live->publish(t, pre_activity, post_activity, synapse.get_weight());
     }
+    if (live) live->finish();
 }
 
-void Simulation::save_results(const std::string& filepath) const {
-    // Write to CSV
-    std::ofstream outfile(filepath);
+void Simulation::set_seed(unsigned int seed) {
+    this->seed = seed;
+    seeded = true;
+}
+
+void Simulation::save_results(const std::string& filepath, size_t buffer_bytes) const {
+    write_results(filepath, results, buffer_bytes);
+}
+
+// --- Result Writing ---
+
+void write_results(const std::string& filepath, const SimRows& rows, size_t buffer_bytes) {
+    // Write to CSV; the stream buffer has to be installed before the file is opened
+    std::ofstream outfile;
+    std::vector<char> buffer(buffer_bytes);
+    if (buffer_bytes > 0) outfile.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    outfile.open(filepath);
     if (!outfile.is_open()) {
         std::cerr << "Error: Could not open output file " << filepath << std::endl;
         return;
@@ -157,7 +343,7 @@ void Simulation::save_results(const std::string& filepath) const {
 
     outfile << "time,pre_activity,post_activity,synaptic_weight,region\n";
 
-    for (const auto& data_point : results) {
+    for (const auto& data_point : rows) {
         outfile << data_point.time << ","
                 << data_point.pre_activity << ","
                 << data_point.post_activity << ","
@@ -167,3 +353,40 @@ void Simulation::save_results(const std::string& filepath) const {
 
     outfile.close();
 }
+
+// --- Result Loading ---
+
+SimRows read_results(const std::string& filepath) {
+    SimRows rows;
+    std::ifstream infile(filepath);
+    if (!infile.is_open()) {
+        std::cerr << "Error: Could not open trajectory file " << filepath << std::endl;
+        return rows;
+    }
+
+    std::string line;
+    std::getline(infile, line);
+    if (line.rfind("time,pre_activity,post_activity,synaptic_weight", 0) != 0) {
+        std::cerr << "Error: " << filepath << " does not start with the save_results header." << std::endl;
+        return rows;
+    }
+    while (std::getline(infile, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        std::stringstream fields(line);
+        std::string time, pre, post, weight, region;
+        std::getline(fields, time, ',');
+        std::getline(fields, pre, ',');
+        std::getline(fields, post, ',');
+        std::getline(fields, weight, ',');
+        std::getline(fields, region);
+        try {
+            rows.push_back({std::stod(time), std::stod(pre), std::stod(post), std::stod(weight), region});
+        } catch (const std::exception&) {
+            std::cerr << "Error: Malformed row in " << filepath << ": " << line << std::endl;
+            rows.clear();
+            return rows;
+        }
+    }
+    return rows;
+}
@@ -1,23 +1,78 @@
 #ifndef SYNAPSE_H
 #define SYNAPSE_H
 
+#include "json.h"
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
 
-// Class to handle configuration
+class LiveStream;
+
+// Malformed config text, or a key that is missing or has the wrong type. The
+// message names the key and, for values read from a file, the line and column.
+class ConfigError : public std::runtime_error {
+public:
+    explicit ConfigError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// Class to handle configuration. The JSON document is parsed once and top-level
+// values are stored by key. Only "regions", "sweep" and "protocol" may hold
+// objects; any other nested object is an error. Numbers, booleans and strings
+// are kept typed, so the getters check the type without parsing text.
 class Config {
 public:
+    Config() {}
     Config(const std::string& config_path);
+    // Parses config text that did not come from a file (e.g. a job sent to the server)
+    static Config from_string(const std::string& content);
 
     double get_double(const std::string& key) const;
+    // Throws for a value that is not a JSON string (a number, array, ...)
     std::string get_string(const std::string& key) const;
+    // Also accepts true/false as 1/0
     int get_int(const std::string& key) const;
+    bool has(const std::string& key) const;
+    const std::map<std::string, std::string>& entries() const { return data; }
+    // Overrides one entry; `raw_value` keeps JSON form (strings quoted)
+    void set(const std::string& key, const std::string& raw_value);
+    // Overrides one entry with `key` of another config, keeping its type
+    void copy_entry(const Config& from, const std::string& key);
+
+    // The runs this config describes. A "regions" array yields one config per
+    // entry, whose keys override the top level. A "sweep" object of value arrays
+    // ({"learning_rate": [0.1, 0.5]}) multiplies that by every combination,
+    // suffixing the region with _<index>. Without either, just this config.
+    std::vector<Config> expand() const;
+    // True if the config has a "regions" or "sweep" section for expand()
+    bool has_runs() const { return regions != nullptr || sweep != nullptr; }
 
 private:
-    void parse();
+    // Parsed form of an entry that came from JSON text
+    struct TypedValue {
+        JsonValue::Type type;
+        double number;
+        size_t line;
+        size_t column;
+        std::string source; // file the value was read from, empty for text
+    };
+
+    void parse_content(const std::string& content);
+    void apply(const JsonValue& object);
+    void assign(const std::string& key, const JsonValue& value);
+    const std::string& raw(const std::string& key) const;
+    ConfigError type_error(const std::string& key, const TypedValue& value, const char* expected) const;
+
     std::string filepath;
     std::map<std::string, std::string> data;
+    std::map<std::string, TypedValue> typed;
+    // The "regions" and "sweep" sections, shared by copies of this config
+    std::shared_ptr<const JsonValue> regions;
+    std::shared_ptr<const JsonValue> sweep;
 };
 
 
@@ -30,6 +85,38 @@ struct SimData {
     std::string region; // Name of the simulated brain region
 };
 
+// A trajectory. Rows allocate from the default heap unless the vector is built
+// on another memory resource, such as a run arena (see run_arena.h).
+using SimRows = std::pmr::vector<SimData>;
+
+// Reads rows written by Simulation::save_results, or the combined
+// synapse_data.csv; a missing region column leaves `region` empty.
+SimRows read_results(const std::string& filepath);
+// Writes rows in the save_results CSV format. `buffer_bytes` sizes the stream
+// buffer (0 keeps the library default); the auto-tuner picks it per machine.
+void write_results(const std::string& filepath, const SimRows& rows, size_t buffer_bytes = 0);
+
+// Hebbian learning rule with decay: dw/dt = -alpha*w + eta*pre*post, clamped to [0, 1].
+// Shared by Synapse::update and the replica-lane ensemble engine. Templated on the
+// number type so the sensitivity run can push dual numbers (dual.h) through it.
+template <typename Real>
+inline Real hebbian_step(Real weight, double pre_activity, double post_activity, const Real& learning_rate, const Real& decay_rate, const Real& dt) {
+    Real dw = (-decay_rate * weight + learning_rate * pre_activity * post_activity) * dt;
+    weight += dw;
+    weight = weight > 1.0 ? Real(1.0) : weight;
+    weight = weight < 0.0 ? Real(0.0) : weight;
+    return weight;
+}
+
+// Number of iterations taken by the `for (t = 0; t < duration; t += dt)` run loop
+inline size_t count_steps(double duration, double dt) {
+    size_t steps = 0;
+    for (double t = 0; t < duration; t += dt) {
+        ++steps;
+    }
+    return steps;
+}
+
 // Class to represent a single synapse
 class Synapse {
 public:
@@ -41,12 +128,40 @@ private:
     double weight;
 };
 
+// Supplies the pre- and post-synaptic activity of each step of Simulation::run
+class ActivitySource {
+public:
+    virtual ~ActivitySource() {}
+    // Activity during the step [t, t + dt); steps arrive in order
+    virtual void next(double t, double dt, double& pre_activity, double& post_activity) = 0;
+};
+
+// The default source: noisy, correlated synthetic spikes
+class RandomActivity : public ActivitySource {
+public:
+    explicit RandomActivity(unsigned int seed);
+    void next(double t, double dt, double& pre_activity, double& post_activity) override;
+
+private:
+    std::mt19937 gen;
+    std::uniform_real_distribution<> dis;
+};
+
 // Class to manage the simulation
 class Simulation {
 public:
-    Simulation(double duration, double dt, double learning_rate, double decay_rate, double initial_weight, std::string region_name);
+    // `resource` holds the results; it must outlive the simulation
+    Simulation(double duration, double dt, double learning_rate, double decay_rate, double initial_weight, std::string region_name,
+               std::pmr::memory_resource* resource = std::pmr::get_default_resource());
     void run();
-    void save_results(const std::string& filepath) const;
+    void save_results(const std::string& filepath, size_t buffer_bytes = 0) const;
+    const SimRows& get_results() const { return results; }
+    // Makes run() reproducible; without a seed each run draws one from std::random_device
+    void set_seed(unsigned int seed);
+    // Publishes every step to a shared-memory stream as well (not owned)
+    void set_live_stream(LiveStream* stream) { live = stream; }
+    // Replaces the synthetic activity with another source, e.g. recorded spikes (not owned)
+    void set_activity_source(ActivitySource* source) { activity = source; }
 
 private:
     // Simulation parameters
@@ -55,12 +170,16 @@ private:
     double learning_rate;
     double decay_rate;
     std::string region;
+    bool seeded = false;
+    unsigned int seed = 0;
+    LiveStream* live = nullptr;
+    ActivitySource* activity = nullptr;
 
     // Simulation objects
     Synapse synapse;
 
     // Data storage
-    std::vector<SimData> results;
+    SimRows results;
 };
 
 #endif // SYNAPSE_H
@@ -1,37 +1,897 @@
 #include "synapse.h"
+#include "autotune.h"
+#include "ensemble.h"
+#include "ensemble_stats.h"
+#include "frame_renderer.h"
+#include "calibration.h"
+#include "column_codec.h"
+#include "correlated_spikes.h"
+#include "decimate.h"
+#include "event_trace.h"
+#include "job_plan.h"
+#include "live_stream.h"
+#include "lod_pyramid.h"
+#include "protocol.h"
+#include "result_cache.h"
+#include "run_arena.h"
+#include "server.h"
+#include "sensitivity.h"
+#include "sobol_indices.h"
+#include "spike_train.h"
+#include "surrogate.h"
+#include "thread_pool.h"
+#include "video_sink.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
-int main(int argc, char* argv[]) {
-    // --- Configuration Loading ---
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <path_to_config.json>" << std::endl;
+// Kernel parameters the auto-tuner picked for this machine; explicit config keys override them
+static TunedParameters tuned;
+
+// Loads this machine's tuning from the cache (tuning on the first run), unless "autotune": 0
+static void load_tuning(const Config& config) {
+    if (config.has("autotune") && config.get_int("autotune") == 0) return;
+    tuned = load_or_tune(config.has("autotune_cache") ? config.get_string("autotune_cache") : "../data/autotune.csv");
+}
+
+// Model parameters plus replica count and seed shared by the multi-replica modes
+static EnsembleConfig load_ensemble_config(const Config& config) {
+    EnsembleConfig ens;
+    ens.sim_duration = config.get_double("sim_duration");
+    ens.dt = config.get_double("dt");
+    ens.learning_rate = config.get_double("learning_rate");
+    ens.decay_rate = config.get_double("decay_rate");
+    ens.initial_weight = config.get_double("initial_weight");
+    ens.replicas = config.has("ensemble_replicas") ? static_cast<size_t>(config.get_int("ensemble_replicas")) : 1;
+    ens.seed = config.has("seed") ? static_cast<uint64_t>(config.get_int("seed")) : 1;
+    if (config.has("record_every")) ens.record_every = static_cast<size_t>(config.get_int("record_every"));
+    ens.lanes = tuned.lanes;
+    return ens;
+}
+
+// d(final weight)/d(parameter) for every parameter from one forward-mode AD pass
+static int run_sensitivity(const Config& config, const std::string& region, std::vector<std::string>& outputs) {
+    EnsembleConfig ens = load_ensemble_config(config);
+    std::cout << "Computing parameter sensitivities for region: '" << region << "' over "
+              << ens.replicas << " replica(s)..." << std::endl;
+
+    SensitivityResult result = run_sensitivities(ens);
+    for (int p = 0; p < kNumSensitivityParams; ++p) {
+        std::cout << "  d(final weight)/d(" << sensitivity_param_name(p) << ") = " << result.gradient[p] << std::endl;
+    }
+
+    std::string output_file = "../data/sensitivity_" + region + ".csv";
+    save_sensitivities(result, output_file);
+    outputs.push_back(output_file);
+    std::cout << "Sensitivities saved to " << output_file << std::endl;
+    return 0;
+}
+
+// Worker threads for the parallel modes; "threads": 0 uses every hardware thread,
+// and without the key the tuned count is used
+static size_t load_thread_count(const Config& config) {
+    return config.has("threads") ? static_cast<size_t>(config.get_int("threads")) : tuned.threads;
+}
+
+// "thread_affinity": none (default), compact or spread; see numa.h
+static AffinityPolicy load_affinity(const Config& config) {
+    AffinityPolicy policy = AffinityPolicy::None;
+    if (config.has("thread_affinity") && !parse_affinity(config.get_string("thread_affinity"), policy)) {
+        throw ConfigError("thread_affinity must be none, compact or spread, not '" + config.get_string("thread_affinity") + "'");
+    }
+    return policy;
+}
+
+// Worker pool shared by every parallel mode in this process, so a server keeps it
+// warm across jobs. It is built from the first config that needs it; threads and
+// thread_affinity of later regions or jobs cannot resize it and are only reported.
+static ThreadPool& worker_pool(const Config& config) {
+    static const size_t threads = load_thread_count(config);
+    static const AffinityPolicy affinity = load_affinity(config);
+    static ThreadPool pool(threads, affinity);
+    if (load_thread_count(config) != threads || load_affinity(config) != affinity) {
+        std::cerr << "Warning: threads and thread_affinity are fixed by the first run in this process; using "
+                  << pool.size() << " threads." << std::endl;
+    }
+    return pool;
+}
+
+// Parameters with "<name>_min" and "<name>_max" keys are varied over that range
+static std::vector<ParameterRange> load_parameter_ranges(const Config& config) {
+    static const char* names[] = {"learning_rate", "decay_rate", "initial_weight", "dt"};
+    std::vector<ParameterRange> ranges;
+    for (const char* name : names) {
+        std::string key = name;
+        if (config.has(key + "_min") && config.has(key + "_max")) {
+            ranges.push_back({key, config.get_double(key + "_min"), config.get_double(key + "_max")});
+        }
+    }
+    return ranges;
+}
+
+// First-order and total Sobol indices of the final weight over the configured ranges
+static int run_sobol(const Config& config, const std::string& region, std::vector<std::string>& outputs) {
+    SobolConfig sobol;
+    sobol.base = load_ensemble_config(config);
+    sobol.base.replicas = config.has("sobol_replicas") ? static_cast<size_t>(config.get_int("sobol_replicas")) : 8;
+    sobol.ranges = load_parameter_ranges(config);
+    if (config.has("sobol_samples")) sobol.base_samples = static_cast<size_t>(config.get_int("sobol_samples"));
+    if (config.has("sobol_bootstrap")) sobol.bootstrap = static_cast<size_t>(config.get_int("sobol_bootstrap"));
+    if (sobol.ranges.empty()) {
+        std::cerr << "Error: Sobol mode needs at least one <parameter>_min/<parameter>_max range." << std::endl;
         return 1;
     }
-    std::string config_path = argv[1];
-    Config config(config_path);
 
+    ThreadPool& pool = worker_pool(config);
+    std::cout << "Running Sobol analysis for region: '" << region << "' ("
+              << sobol.base_samples * (sobol.ranges.size() + 2) << " runs on "
+              << pool.size() << " threads)..." << std::endl;
+
+    std::vector<SobolRun> runs;
+    std::vector<SobolIndex> indices = compute_sobol_indices(sobol, pool, &runs);
+    for (const auto& index : indices) {
+        std::cout << "  " << index.name << ": S1 = " << index.first_order
+                  << " [" << index.first_order_low << ", " << index.first_order_high << "], ST = "
+                  << index.total << " [" << index.total_low << ", " << index.total_high << "]" << std::endl;
+    }
+
+    std::string output_file = "../data/sobol_indices_" + region + ".csv";
+    std::string runs_file = "../data/sobol_runs_" + region + ".csv";
+    save_sobol_indices(indices, output_file);
+    save_sobol_runs(sobol, runs, runs_file);
+    outputs.push_back(output_file);
+    outputs.push_back(runs_file);
+    std::cout << "Sobol indices saved to " << output_file << " (runs in " << runs_file << ")" << std::endl;
+    return 0;
+}
+
+// Searches the configured parameter ranges for a fit to target final-weight statistics
+static int run_calibration(const Config& config, const std::string& region, std::vector<std::string>& outputs) {
+    CalibrationConfig calibration;
+    calibration.base = load_ensemble_config(config);
+    calibration.base.replicas = config.has("calibration_replicas") ? static_cast<size_t>(config.get_int("calibration_replicas")) : 32;
+    calibration.ranges = load_parameter_ranges(config);
+    calibration.target.mean_final_weight = config.get_double("target_mean_weight");
+    if (config.has("target_std_weight")) calibration.target.std_final_weight = config.get_double("target_std_weight");
+    if (config.has("calibration_max_runs")) calibration.max_runs = static_cast<size_t>(config.get_double("calibration_max_runs"));
+    if (config.has("calibration_max_seconds")) calibration.max_seconds = config.get_double("calibration_max_seconds");
+    if (config.has("calibration_population")) calibration.population = static_cast<size_t>(config.get_int("calibration_population"));
+    if (calibration.ranges.empty()) {
+        std::cerr << "Error: Calibration mode needs at least one <parameter>_min/<parameter>_max range." << std::endl;
+        return 1;
+    }
+
+    ThreadPool& pool = worker_pool(config);
+    std::cout << "Calibrating region: '" << region << "' with CMA-ES on " << pool.size() << " threads..." << std::endl;
+    Calibrator calibrator(calibration, pool);
+    CalibrationResult result = calibrator.run();
+
+    for (size_t i = 0; i < result.best_params.size(); ++i) {
+        std::cout << "  " << calibration.ranges[i].name << " = " << result.best_params[i] << std::endl;
+    }
+    std::cout << "  loss " << result.best_loss << " (mean " << result.best_mean << ", std " << result.best_std << ") after "
+              << result.evaluations << " evaluations, " << result.cache_hits << " cache hits, "
+              << result.generations << " generations, " << result.seconds << " s" << std::endl;
+
+    std::string output_file = "../data/calibration_" + region + ".csv";
+    save_calibration(calibration, result, output_file);
+    outputs.push_back(output_file);
+    std::cout << "Calibration saved to " << output_file << std::endl;
+    return 0;
+}
+
+// Sweep summary the surrogate is fitted on and the points it is asked about
+static std::string surrogate_training_file(const Config& config, const std::string& region) {
+    return config.has("surrogate_training_file") ? config.get_string("surrogate_training_file") : "../data/sobol_runs_" + region + ".csv";
+}
+
+static std::string surrogate_query_file(const Config& config, const std::string& region) {
+    return config.has("surrogate_query_file") ? config.get_string("surrogate_query_file") : "../data/surrogate_queries_" + region + ".csv";
+}
+
+// Answers parameter points from a surrogate fitted on a stored sweep, falling back
+// to a real run wherever the model is too uncertain
+static int run_surrogate(const Config& config, const std::string& region, std::vector<std::string>& outputs) {
+    SweepTable training, queries;
+    if (!read_sweep_table(surrogate_training_file(config, region), training)) return 1;
+    if (!read_sweep_table(surrogate_query_file(config, region), queries)) return 1;
+
+    std::vector<std::string> inputs;
+    for (const auto& column : training.columns) {
+        if (is_parameter(column)) inputs.push_back(column);
+    }
+    std::vector<int> query_columns;
+    for (const auto& name : inputs) {
+        int column = queries.column_index(name);
+        if (column < 0) {
+            std::cerr << "Error: Query file is missing parameter column '" << name << "'." << std::endl;
+            return 1;
+        }
+        query_columns.push_back(column);
+    }
+
+    const size_t features = config.has("surrogate_features") ? static_cast<size_t>(config.get_int("surrogate_features")) : 256;
+    const double lengthscale = config.has("surrogate_lengthscale") ? config.get_double("surrogate_lengthscale") : 0.3;
+    const double ridge = config.has("surrogate_ridge") ? config.get_double("surrogate_ridge") : 1e-3;
+    const double max_std = config.has("surrogate_max_std") ? config.get_double("surrogate_max_std") : 0.01;
+    Surrogate surrogate(features, lengthscale, ridge, config.has("seed") ? static_cast<uint64_t>(config.get_int("seed")) : 1);
+    if (!surrogate.fit(training, inputs, "final_weight")) {
+        std::cerr << "Error: Could not fit surrogate (needs parameter columns and final_weight)." << std::endl;
+        return 1;
+    }
+    std::cout << "Fitted surrogate on " << training.rows.size() << " runs over " << inputs.size()
+              << " parameters (noise std " << std::sqrt(surrogate.get_noise_variance()) << ")" << std::endl;
+
+    // Points the model is unsure about are simulated with the sweep's replica count
+    EnsembleConfig base = load_ensemble_config(config);
+    base.replicas = config.has("surrogate_replicas") ? static_cast<size_t>(config.get_int("surrogate_replicas")) : 8;
+
+    std::string output_file = "../data/surrogate_" + region + ".csv";
+    std::ofstream outfile(output_file);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << output_file << std::endl;
+        return 1;
+    }
+    for (const auto& name : inputs) outfile << name << ",";
+    outfile << "final_weight,variance,model_std,source\n";
+
+    size_t simulated = 0;
+    std::vector<double> x(inputs.size());
+    for (const auto& row : queries.rows) {
+        for (size_t i = 0; i < inputs.size(); ++i) x[i] = row[query_columns[i]];
+        SurrogatePrediction prediction = surrogate.predict(x);
+        const char* source = "surrogate";
+        if (prediction.model_std > max_std) {
+            EnsembleConfig run = base;
+            for (size_t i = 0; i < inputs.size(); ++i) set_parameter(run, inputs[i], x[i]);
+            FinalWeightSummary summary = summarize_final_weight(run);
+            prediction.mean = summary.mean;
+            prediction.variance = summary.variance / run.replicas;
+            prediction.model_std = 0;
+            source = "simulation";
+            ++simulated;
+        }
+        for (double value : x) outfile << value << ",";
+        outfile << prediction.mean << "," << prediction.variance << "," << prediction.model_std << "," << source << "\n";
+    }
+    outfile.close();
+    outputs.push_back(output_file);
+
+    std::cout << "Answered " << queries.rows.size() << " queries (" << simulated
+              << " simulated above model std " << max_std << "). Saved to " << output_file << std::endl;
+    return 0;
+}
+
+// Runs `ensemble_replicas` independent replicas of the synapse in SIMD lane blocks
+static int run_ensemble(const Config& config, const std::string& region, std::vector<std::string>& outputs) {
+    EnsembleConfig ens = load_ensemble_config(config);
+    if (config.has("ensemble_lanes")) ens.lanes = config.get_int("ensemble_lanes");
+    if (config.has("qmc_points")) ens.qmc_points = static_cast<size_t>(config.get_int("qmc_points"));
+    const std::string sampling = config.has("ensemble_sampling") ? config.get_string("ensemble_sampling") : "mc";
+    if (sampling == "antithetic") {
+        ens.sampling = Sampling::Antithetic;
+    } else if (sampling == "qmc") {
+        ens.sampling = Sampling::QuasiMonteCarlo;
+    } else if (sampling != "mc") {
+        std::cerr << "Error: Unknown ensemble_sampling '" << sampling << "' (expected mc, antithetic or qmc)." << std::endl;
+        return 1;
+    }
+    const bool control_variate = config.has("ensemble_control_variate") && config.get_int("ensemble_control_variate") != 0;
+
+    Ensemble ensemble(ens);
+    std::cout << "Running " << ens.replicas << "-replica ensemble for region: '" << region << "'..." << std::endl;
+
+    // Grouped statistics average whole antithetic pairs or QMC point sets only
+    const size_t group = ensemble.group_size();
+    const std::string output = config.has("ensemble_output") ? config.get_string("ensemble_output") : "final";
+    const bool grouped = output == "stats" || config.has("ensemble_ci_half_width") || control_variate;
+    if (config.has("qmc_points") && ensemble.get_config().qmc_points != ens.qmc_points) {
+        std::cout << "Using " << group << " points per QMC set (qmc_points " << ens.qmc_points
+                  << " rounded to a power of two that fits the ensemble)" << std::endl;
+    }
+    // A spread needs two samples; the control variate's residual spends one more on its coefficient
+    const size_t min_groups = control_variate ? 3 : 2;
+    if (grouped && ens.replicas < min_groups * group) {
+        std::cerr << "Error: ensemble_replicas (" << ens.replicas << ") is too few for an error estimate, which needs "
+                  << min_groups * group << " replicas";
+        if (group > 1) std::cerr << " (" << min_groups << " " << sampling << " groups of " << group << ")";
+        std::cerr << "." << std::endl;
+        return 1;
+    }
+    if (grouped && ens.replicas % group != 0) {
+        std::cerr << "Warning: The last " << ens.replicas % group << " replicas do not fill a " << sampling << " group of "
+                  << group << " and are left out of the statistics." << std::endl;
+    }
+
+    // The control variate observes the same replicas whichever output is written
+    ControlVariateEstimator cv(ensemble.num_steps(), ensemble.group_size());
+    ObserverGroup observers;
+    if (control_variate) observers.add(&cv);
+
+    if (output == "stats" || config.has("ensemble_ci_half_width")) {
+        // Mean weight trajectory with a 95% band; with a target half-width, replicas
+        // are launched until the band is narrow enough (ensemble_replicas is the cap).
+        std::string output_file = "../data/ensemble_stats_" + region + ".csv";
+        EnsembleStatsObserver stats(ensemble.num_samples(), ensemble.group_size());
+        StoppingRule rule;
+        if (config.has("ensemble_ci_half_width")) {
+            rule.target_half_width = config.get_double("ensemble_ci_half_width");
+            rule.max_replicas = ens.replicas;
+            if (config.has("ensemble_min_replicas")) rule.min_replicas = static_cast<size_t>(config.get_int("ensemble_min_replicas"));
+            size_t used = run_until_converged(ensemble, stats, rule, control_variate ? &cv : nullptr);
+            if (used == 0) return 1;
+            std::cout << "Stopped after " << used << " replicas (max CI half-width "
+                      << stats.max_ci_half_width(rule.z) << ", target " << rule.target_half_width << ")" << std::endl;
+        } else {
+            observers.add(&stats);
+            ensemble.run(observers);
+        }
+        stats.save(output_file, rule.z);
+        outputs.push_back(output_file);
+        std::cout << "Ensemble statistics saved to " << output_file << std::endl;
+    } else if (output == "trajectories") {
+        std::string output_file = "../data/ensemble_trajectories_" + region + ".csv";
+        TrajectoryRecorder recorder(output_file);
+        if (!recorder.is_open()) return 1;
+        observers.add(&recorder);
+        ensemble.run(observers);
+        outputs.push_back(output_file);
+        std::cout << "Ensemble trajectories saved to " << output_file << std::endl;
+    } else {
+        std::string output_file = "../data/ensemble_" + region + ".csv";
+        FinalStateRecorder recorder;
+        observers.add(&recorder);
+        ensemble.run(observers);
+        recorder.save(output_file, ens.sim_duration);
+        outputs.push_back(output_file);
+        std::cout << "Ensemble final states saved to " << output_file << std::endl;
+    }
+
+    if (control_variate) {
+        std::string cv_file = "../data/ensemble_cv_" + region + ".csv";
+        cv.save(cv_file);
+        outputs.push_back(cv_file);
+        std::cout << "Control-variate final weight: " << cv.estimate() << " +/- " << cv.std_error()
+                  << " (plain mean " << cv.naive_mean() << " +/- " << cv.naive_std_error() << ")" << std::endl;
+    }
+    return 0;
+}
+
+// Writes a plot-sized copy of a trajectory (same columns, decimate_points rows
+// per region) that plot_synapse.py and stat_plots.R read like the full file
+static int decimate_rows(const Config& config, const SimRows& rows, const std::string& output_file) {
+    const size_t points = config.has("decimate_points") ? static_cast<size_t>(config.get_int("decimate_points")) : 2000;
+    const std::string method = config.has("decimate_method") ? config.get_string("decimate_method") : "lttb";
+
+    SimRows decimated;
+    if (!decimate_regions(rows, points, method, worker_pool(config), decimated)) return 1;
+    write_results(output_file, decimated);
+    std::cout << "Decimated " << rows.size() << " rows to " << decimated.size() << " (" << method
+              << ") in " << output_file << std::endl;
+    return 0;
+}
+
+// The same for a trajectory CSV written earlier (--decimate)
+static int decimate_file(const Config& config, const std::string& input_file, const std::string& output_file) {
+    SimRows rows = read_results(input_file);
+    if (rows.empty()) {
+        std::cerr << "Error: No samples to decimate in " << input_file << std::endl;
+        return 1;
+    }
+    return decimate_rows(config, rows, output_file);
+}
+
+// Per-run state of the calling thread, reused from one run to the next: the sweep
+// loop and each server worker keep their own
+static RunArena& run_arena() {
+    thread_local RunArena arena;
+    return arena;
+}
+
+// The original single-synapse run writing the full per-step trace
+static int run_single(const Config& config, const std::string& region, std::vector<std::string>& outputs) {
     // Load parameters from config object
     const double sim_duration = config.get_double("sim_duration");
     const double dt = config.get_double("dt");
     const double learning_rate = config.get_double("learning_rate");
     const double decay_rate = config.get_double("decay_rate");
     const double initial_weight = config.get_double("initial_weight");
-    const std::string region = config.get_string("region");
 
     // --- Simulation Setup ---
     // Construct output path based on region
     std::string output_file = "../data/synapse_data_" + region + ".csv";
 
+    // The previous run's state is dropped in one go. The arena is sized as --plan
+    // sizes it, but without opening inputs: recorded and protocol runs start from
+    // the synthetic event rate, and any overflow is kept for the next run.
+    RunArena& arena = run_arena();
+    arena.reset(single_arena_bytes(config, count_steps(sim_duration, dt), synthetic_event_fraction(config)));
+
     // Create the simulation object
-    Simulation sim(sim_duration, dt, learning_rate, decay_rate, initial_weight, region);
+    Simulation sim(sim_duration, dt, learning_rate, decay_rate, initial_weight, region, arena.buffer());
+    if (config.has("seed")) sim.set_seed(static_cast<unsigned int>(config.get_int("seed")));
+
+    // Optional live feed for python_visualization/live_reader.py
+    std::unique_ptr<LiveStream> live;
+    if (config.has("live_stream")) {
+        size_t capacity = config.has("live_stream_capacity") ? static_cast<size_t>(config.get_int("live_stream_capacity")) : 65536;
+        live.reset(new LiveStream(config.get_string("live_stream"), region, capacity));
+        if (!live->is_open()) return 1;
+        sim.set_live_stream(live.get());
+        std::cout << "Streaming live samples to shared memory " << config.get_string("live_stream") << std::endl;
+    }
+
+    // Recorded spikes replace the synthetic activity
+    std::unique_ptr<MappedSpikeTrain> recorded;
+    if (config.has("spike_input")) {
+        recorded.reset(new MappedSpikeTrain(config.get_string("spike_input")));
+        if (!recorded->is_open()) return 1;
+        sim.set_activity_source(recorded.get());
+        std::cout << "Replaying " << recorded->num_spikes(0) << " pre and " << recorded->num_spikes(1)
+                  << " post spikes from " << config.get_string("spike_input") << std::endl;
+    }
+
+    // A stimulation protocol replaces the synthetic activity as well
+    std::unique_ptr<ProtocolActivity> stimulation;
+    if (config.has("protocol")) {
+        if (recorded) {
+            std::cerr << "Error: Use only one of spike_input, protocol and spike_correlation." << std::endl;
+            return 1;
+        }
+        std::vector<StimulusEvent> schedule;
+        if (!compile_protocol(config.get_string("protocol"), schedule)) return 1;
+        stimulation.reset(new ProtocolActivity(std::move(schedule)));
+        sim.set_activity_source(stimulation.get());
+        std::cout << "Stimulation protocol compiled to " << stimulation->num_events() << " pulse times" << std::endl;
+    }
+
+    // Or Poisson pre/post trains with a chosen correlation
+    std::unique_ptr<CorrelatedActivity> correlated;
+    if (config.has("spike_correlation")) {
+        if (recorded || stimulation) {
+            std::cerr << "Error: Use only one of spike_input, protocol and spike_correlation." << std::endl;
+            return 1;
+        }
+        const double pre_rate = config.has("pre_rate") ? config.get_double("pre_rate") : 30.0;
+        const double post_rate = config.has("post_rate") ? config.get_double("post_rate") : 30.0;
+        const uint64_t seed = config.has("seed") ? static_cast<uint64_t>(config.get_int("seed")) : std::random_device()();
+        correlated.reset(new CorrelatedActivity(pre_rate, post_rate, config.get_double("spike_correlation"), dt, seed));
+        if (!correlated->is_valid()) return 1;
+        sim.set_activity_source(correlated.get());
+    }
 
     // --- Execution ---
     std::cout << "Running simulation for region: '" << region << "'..." << std::endl;
     sim.run();
-    sim.save_results(output_file);
+    sim.save_results(output_file, tuned.csv_buffer);
+    outputs.push_back(output_file);
+
+    if (config.has("decimate_points")) {
+        std::string decimated_file = "../data/synapse_data_" + region + "_decimated.csv";
+        if (decimate_rows(config, sim.get_results(), decimated_file) != 0) return 1;
+        outputs.push_back(decimated_file);
+    }
+
+    // Compressed copy for archiving and transfer (decode with --decompress)
+    if (config.has("compress_output") && config.get_int("compress_output") != 0) {
+        std::string compressed_file = "../data/synapse_data_" + region + ".qdc";
+        int bits = config.has("compress_weight_bits") ? config.get_int("compress_weight_bits") : 52;
+        if (!save_compressed(compressed_file, sim.get_results(), bits)) return 1;
+        outputs.push_back(compressed_file);
+        std::cout << "Compressed trajectory saved to " << compressed_file << std::endl;
+    }
+
+    // Spike events only; --expand rebuilds the dense trace exactly
+    if (config.has("event_output") && config.get_int("event_output") != 0) {
+        std::string event_file = "../data/synapse_events_" + region + ".csv";
+        EventTrace trace(dt, learning_rate, decay_rate, initial_weight, region, arena.pool());
+        if (!trace.record(sim.get_results()) || !trace.save(event_file)) return 1;
+        outputs.push_back(event_file);
+        std::cout << "Spike events (" << trace.get_events().size() << " of " << trace.num_steps()
+                  << " steps) saved to " << event_file << std::endl;
+    }
+
+    // Optional min/max/mean rollups for zoomable plots (python_visualization/lod_reader.py)
+    if (config.has("lod_pyramid") && config.get_int("lod_pyramid") != 0) {
+        std::string lod_file = "../data/synapse_lod_" + region + ".bin";
+        if (!save_lod_pyramid(sim.get_results(), lod_file)) return 1;
+        outputs.push_back(lod_file);
+        std::cout << "Level-of-detail pyramid saved to " << lod_file << std::endl;
+    }
 
     std::cout << "C++ simulation for region '" << region << "' finished. Data saved to " << output_file << std::endl;
+    return 0;
+}
+
+static int run_mode(const Config& config, const std::string& mode, const std::string& region, std::vector<std::string>& outputs) {
+    if (mode == "ensemble") return run_ensemble(config, region, outputs);
+    if (mode == "sensitivity") return run_sensitivity(config, region, outputs);
+    if (mode == "sobol") return run_sobol(config, region, outputs);
+    if (mode == "calibrate") return run_calibration(config, region, outputs);
+    if (mode == "surrogate") return run_surrogate(config, region, outputs);
+    if (mode == "single") return run_single(config, region, outputs);
+    std::cerr << "Error: Unknown mode '" << mode << "'." << std::endl;
+    return 1;
+}
+
+// Outputs are a pure function of the config when every random stream is seeded
+// and no wall-clock budget can cut a run short
+static bool is_reproducible(const Config& config, const std::string& mode) {
+    if (mode == "single") return config.has("seed") || config.has("spike_input") || config.has("protocol");
+    if (mode == "calibrate") return !config.has("calibration_max_seconds");
+    return true;
+}
+
+// Runs one config through the result cache: an identical earlier run is restored,
+// anything else is simulated and stored
+static int run_cached(const Config& config, std::vector<std::string>& outputs) {
+    const std::string region = config.get_string("region");
+    const std::string mode = config.has("mode") ? config.get_string("mode") : "single";
+
+    // --- Result Cache ---
+    // Identical reruns (same normalized config, seed, model version and build) are
+    // served from the local store instead of being simulated again.
+    // A live stream is a side effect a restored result would not reproduce
+    const bool use_cache = (!config.has("cache") || config.get_int("cache") != 0) && is_reproducible(config, mode) &&
+                           !config.has("live_stream");
+    const std::string cache_dir = config.has("cache_dir") ? config.get_string("cache_dir") : "../data/.cache";
+    const double cache_max_mb = config.has("cache_max_mb") ? config.get_double("cache_max_mb") : 1024.0;
+    ResultCache cache(cache_dir, static_cast<uintmax_t>(cache_max_mb * 1024 * 1024));
+    std::vector<std::string> input_files;
+    if (mode == "surrogate") {
+        input_files.push_back(surrogate_training_file(config, region));
+        input_files.push_back(surrogate_query_file(config, region));
+    }
+    if (config.has("spike_input")) input_files.push_back(config.get_string("spike_input"));
+    const std::string cache_key = use_cache ? ResultCache::make_key(config, input_files) : "";
+
+    if (use_cache && cache.restore(cache_key, outputs)) {
+        for (const auto& output : outputs) {
+            std::cout << "Cache hit (" << cache_key << "): restored " << output << std::endl;
+        }
+        return 0;
+    }
+
+    int status = run_mode(config, mode, region, outputs);
+    if (status == 0 && use_cache) {
+        cache.store(cache_key, outputs);
+    }
+    return status;
+}
+
+static bool flag_set(const Config& config, const std::string& key) {
+    return config.has(key) && config.get_int(key) != 0;
+}
+
+// Rasterizes every region in a trajectory CSV, replacing the per-step matplotlib
+// loop of plot_synapse.py: as <frames_dir>/<region>/frame_%04d.<frame_format>
+// images and/or, streamed without intermediate files, <video_dir>/<region>_simulation.mp4
+static int render_outputs(const Config& config, const std::string& trajectory_file, bool frames, bool video) {
+    SimRows rows = read_results(trajectory_file);
+    if (rows.empty()) {
+        std::cerr << "Error: No samples to render in " << trajectory_file << std::endl;
+        return 1;
+    }
+    std::map<std::string, SimRows> regions;
+    for (const auto& row : rows) regions[row.region.empty() ? "default" : row.region].push_back(row);
 
+    const std::string frames_dir = config.has("frames_dir") ? config.get_string("frames_dir") : "../frames";
+    const std::string format = config.has("frame_format") ? config.get_string("frame_format") : "png";
+    const int width = config.has("frame_width") ? config.get_int("frame_width") : 1000;
+    const int height = config.has("frame_height") ? config.get_int("frame_height") : 800;
+    if (format != "png" && format != "ppm") {
+        std::cerr << "Error: Unknown frame_format '" << format << "' (expected png or ppm)." << std::endl;
+        return 1;
+    }
+    const std::string video_dir = config.has("video_dir") ? config.get_string("video_dir") : "../videos";
+    const double fps = config.has("video_fps") ? config.get_double("video_fps") : 30.0;
+    const std::string encoder = config.has("video_encoder") ? config.get_string("video_encoder") : "auto";
+    const std::string codec = config.has("video_codec") ? config.get_string("video_codec") : "libx264";
+    // Frames follow the video clock when a playback speed or video length is given
+    const bool resample = config.has("playback_speed") || config.has("video_seconds");
+
+    ThreadPool& pool = worker_pool(config);
+    for (const auto& region : regions) {
+        FrameRenderer renderer(region.second, width, height);
+        if (resample) {
+            double span = region.second.back().time - region.second.front().time;
+            double speed = config.has("video_seconds") ? span / config.get_double("video_seconds")
+                                                       : config.get_double("playback_speed");
+            if (!(speed > 0) || !(fps > 0)) {
+                std::cerr << "Error: video_fps, playback_speed and video_seconds must be positive." << std::endl;
+                return 1;
+            }
+            renderer.resample(fps, speed);
+        }
+        std::cout << "Rendering " << renderer.num_frames() << " frames for region '" << region.first
+                  << "' on " << pool.size() << " threads..." << std::endl;
+        if (frames) {
+            const std::string directory = frames_dir + "/" + region.first;
+            ImageSequenceSink sink(directory, format);
+            if (!renderer.render(sink, pool)) {
+                std::cerr << "Error: Could not write frames to " << directory << std::endl;
+                return 1;
+            }
+            std::cout << "Frames for region '" << region.first << "' saved in " << directory << "/" << std::endl;
+        }
+        if (video) {
+            std::unique_ptr<FrameSink> sink = open_video_sink(video_dir + "/" + region.first + "_simulation.mp4",
+                                                              width, height, fps, encoder, codec);
+            if (!sink || !renderer.render(*sink, pool)) {
+                std::cerr << "Error: Could not encode the video for region '" << region.first << "'." << std::endl;
+                return 1;
+            }
+            std::cout << "Video for region '" << region.first << "' saved in " << video_dir << "/" << std::endl;
+        }
+    }
+    return 0;
+}
+
+// Converts between trajectory CSVs and the compressed column format (.qdc)
+static int convert_compressed(bool compress, const std::string& input_file, std::string output_file) {
+    if (output_file.empty()) {
+        std::string::size_type dot = input_file.rfind('.');
+        output_file = (dot == std::string::npos ? input_file : input_file.substr(0, dot)) + (compress ? ".qdc" : ".csv");
+    }
+    SimRows rows;
+    if (compress) {
+        // The CSV only keeps 6 significant digits, which 21 mantissa bits preserve
+        rows = read_results(input_file);
+        if (rows.empty() || !save_compressed(output_file, rows, 21)) return 1;
+    } else {
+        ThreadPool pool;
+        if (!load_compressed(input_file, rows, &pool)) return 1;
+        write_results(output_file, rows);
+    }
+    std::cout << (compress ? "Compressed " : "Decompressed ") << rows.size() << " rows from " << input_file
+              << " to " << output_file << std::endl;
+    return 0;
+}
+
+// Rebuilds the dense trajectory CSV (all steps, or [begin, end)) from a spike event file
+static int expand_events(const std::string& input_file, std::string output_file, size_t begin, size_t end) {
+    EventTrace trace;
+    if (!trace.load(input_file)) return 1;
+    if (output_file.empty()) {
+        std::string::size_type dot = input_file.rfind('.');
+        output_file = (dot == std::string::npos ? input_file : input_file.substr(0, dot)) + "_dense.csv";
+    }
+    SimRows rows = trace.expand(begin, end);
+    write_results(output_file, rows);
+    std::cout << "Expanded " << trace.get_events().size() << " events to " << rows.size() << " rows in "
+              << output_file << std::endl;
     return 0;
-}
\ No newline at end of file
+}
+
+// Packs a "channel,time" CSV of recorded spikes (channel pre or post) into a spike-train file
+static int encode_spikes(const std::string& input_file, const std::string& output_file, double tick) {
+    std::ifstream infile(input_file);
+    if (!infile.is_open()) {
+        std::cerr << "Error: Could not open spike file " << input_file << std::endl;
+        return 1;
+    }
+    std::vector<double> pre_spikes, post_spikes;
+    std::string line;
+    std::getline(infile, line);
+    while (std::getline(infile, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        std::string::size_type comma = line.find(',');
+        std::string channel = line.substr(0, comma);
+        try {
+            if (comma == std::string::npos || (channel != "pre" && channel != "post")) throw std::invalid_argument(line);
+            (channel == "pre" ? pre_spikes : post_spikes).push_back(std::stod(line.substr(comma + 1)));
+        } catch (const std::exception&) {
+            std::cerr << "Error: Malformed spike row in " << input_file << ": " << line << std::endl;
+            return 1;
+        }
+    }
+    if (!write_spike_train(output_file, tick, pre_spikes, post_spikes)) return 1;
+    std::cout << "Encoded " << pre_spikes.size() << " pre and " << post_spikes.size() << " post spikes to "
+              << output_file << std::endl;
+    return 0;
+}
+
+// Writes a correlated population as sparse "channel,time" rows (channel = index)
+static int generate_population(const Config& config, const std::string& output_file) {
+    const size_t size = config.has("population_size") ? static_cast<size_t>(config.get_int("population_size")) : 100;
+    const double rate = config.has("population_rate") ? config.get_double("population_rate") : 20.0;
+    const double correlation = config.has("spike_correlation") ? config.get_double("spike_correlation") : 0.1;
+    const double dt = config.get_double("dt");
+    const uint64_t seed = config.has("seed") ? static_cast<uint64_t>(config.get_int("seed")) : 1;
+    CorrelatedSpikeGenerator generator(std::vector<double>(size, rate), std::vector<double>(size, correlation), dt, seed);
+    if (generator.num_channels() != size || size == 0) return 1;
+
+    std::ofstream outfile(output_file);
+    if (!outfile.is_open()) {
+        std::cerr << "Error: Could not open output file " << output_file << std::endl;
+        return 1;
+    }
+    outfile << "channel,time\n";
+
+    // Generate in blocks of steps so the raster stays small however long the run is
+    ThreadPool& pool = worker_pool(config);
+    const size_t steps = count_steps(config.get_double("sim_duration"), dt);
+    const size_t block = std::max<size_t>(1, (size_t(1) << 22) / size);
+    FirstTouchVector<uint8_t> raster;
+    size_t spikes = 0;
+    double t = 0;
+    for (size_t begin = 0; begin < steps; begin += block) {
+        const size_t end = std::min(steps, begin + block);
+        generator.fill(begin, end, raster, &pool, tuned.spike_grain);
+        for (size_t s = 0; s < end - begin; ++s, t += dt) {
+            for (size_t c = 0; c < size; ++c) {
+                if (raster[s * size + c]) {
+                    outfile << c << "," << t << "\n";
+                    ++spikes;
+                }
+            }
+        }
+    }
+    std::cout << "Generated " << spikes << " spikes over " << size << " channels (pairwise correlation "
+              << (size > 1 ? generator.pair_correlation(0, 1) : 1.0) << ") in " << output_file << std::endl;
+    return 0;
+}
+
+// Dry run: predicts memory, outputs and runtime of every run in a config without
+// simulating, from the kernel costs `--benchmark` measured on this machine
+static int plan_runs(const std::string& config_path, const std::string& format) {
+    if (format != "text" && format != "json") {
+        std::cerr << "Error: Unknown plan format '" << format << "' (expected text or json)." << std::endl;
+        return 1;
+    }
+    Config file_config(config_path);
+    const std::string costs_file = file_config.has("kernel_costs") ? file_config.get_string("kernel_costs") : "../data/kernel_costs.csv";
+    KernelCosts costs;
+    if (!costs.load(costs_file) && format == "text") {
+        std::cout << "Note: " << costs_file << " not found; runtimes use uncalibrated defaults (run --benchmark)." << std::endl;
+    }
+    // Runs without a "threads" key use the tuned count once this machine has been tuned
+    TunedParameters machine;
+    const bool machine_tuned = load_tuned_parameters(
+        file_config.has("autotune_cache") ? file_config.get_string("autotune_cache") : "../data/autotune.csv", machine);
+    for (Config config : file_config.expand()) {
+        if (machine_tuned && !config.has("threads")) config.set("threads", std::to_string(machine.threads));
+        print_plan(std::cout, plan_job(config, costs), format == "json");
+    }
+    return 0;
+}
+
+static int benchmark_kernels(const std::string& output_file) {
+    std::cout << "Measuring kernel costs..." << std::endl;
+    KernelCosts costs = measure_kernel_costs();
+    if (!costs.save(output_file)) return 1;
+    std::cout << "Kernel costs saved to " << output_file << std::endl;
+    return 0;
+}
+
+// Daemon mode: keeps workers, pools and caches warm between jobs sent over a Unix socket
+static int serve(const std::string& socket_path, const Config& defaults) {
+    if (defaults.has_runs()) throw ConfigError("Server defaults cannot have \"regions\" or \"sweep\".");
+    ServerOptions options;
+    options.socket_path = socket_path;
+    options.defaults = defaults;
+    options.workers = defaults.has("server_workers") ? static_cast<size_t>(defaults.get_int("server_workers")) : 0;
+    options.lanes = tuned.lanes;
+    options.run_files = run_cached;
+    SimulationServer server(options);
+    return server.run();
+}
+
+// Command-line numbers are checked like config values, so a typo is a ConfigError, not an abort
+static size_t parse_count(const char* text, const std::string& name) {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || std::string(text).find('-') != std::string::npos) {
+        throw ConfigError("Invalid " + name + " \"" + text + "\": expected a non-negative integer.");
+    }
+    return static_cast<size_t>(value);
+}
+
+static double parse_positive(const char* text, const std::string& name) {
+    char* end = nullptr;
+    errno = 0;
+    double value = std::strtod(text, &end);
+    if (end == text || *end != '\0' || errno == ERANGE || !std::isfinite(value) || !(value > 0)) {
+        throw ConfigError("Invalid " + name + " \"" + text + "\": expected a positive number.");
+    }
+    return value;
+}
+
+static int run_command(int argc, char* argv[]) {
+    // --- Configuration Loading ---
+    if (argc >= 3 && std::string(argv[1]) == "--serve") {
+        Config defaults = argc >= 4 ? Config(argv[3]) : Config();
+        load_tuning(defaults);
+        return serve(argv[2], defaults);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--render") {
+        Config config = argc >= 4 ? Config(argv[3]) : Config();
+        bool video = flag_set(config, "render_video");
+        return render_outputs(config, argv[2], flag_set(config, "render_frames") || !video, video);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--decimate") {
+        std::string input = argv[2];
+        std::string::size_type dot = input.rfind(".csv");
+        std::string output = (dot == std::string::npos ? input : input.substr(0, dot)) + "_decimated.csv";
+        return decimate_file(argc >= 4 ? Config(argv[3]) : Config(), input, output);
+    }
+    if (argc >= 3 && (std::string(argv[1]) == "--compress" || std::string(argv[1]) == "--decompress")) {
+        return convert_compressed(std::string(argv[1]) == "--compress", argv[2], argc >= 4 ? argv[3] : "");
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--expand") {
+        size_t begin = argc >= 5 ? parse_count(argv[4], "begin_step") : 0;
+        size_t end = argc >= 6 ? parse_count(argv[5], "end_step") : static_cast<size_t>(-1);
+        return expand_events(argv[2], argc >= 4 ? argv[3] : "", begin, end);
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--correlated-spikes") {
+        Config config(argv[2]);
+        load_tuning(config);
+        return generate_population(config, argv[3]);
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--encode-spikes") {
+        return encode_spikes(argv[2], argv[3], argc >= 5 ? parse_positive(argv[4], "tick") : 1e-4);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--plan") {
+        return plan_runs(argv[2], argc >= 4 ? argv[3] : "text");
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--autotune") {
+        // Re-tunes even when this machine already has a cached choice
+        load_or_tune(argc >= 3 ? argv[2] : "../data/autotune.csv", true);
+        return 0;
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--benchmark") {
+        return benchmark_kernels(argc >= 3 ? argv[2] : "../data/kernel_costs.csv");
+    }
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <path_to_config.json>" << std::endl;
+        std::cerr << "       " << argv[0] << " --serve <socket_path> [defaults_config.json]" << std::endl;
+        std::cerr << "       " << argv[0] << " --render <trajectory.csv> [config.json]" << std::endl;
+        std::cerr << "       " << argv[0] << " --decimate <trajectory.csv> [config.json]" << std::endl;
+        std::cerr << "       " << argv[0] << " --compress <trajectory.csv> [output.qdc]" << std::endl;
+        std::cerr << "       " << argv[0] << " --decompress <trajectory.qdc> [output.csv]" << std::endl;
+        std::cerr << "       " << argv[0] << " --expand <events.csv> [output.csv] [begin_step end_step]" << std::endl;
+        std::cerr << "       " << argv[0] << " --encode-spikes <spikes.csv> <output.qds> [tick]" << std::endl;
+        std::cerr << "       " << argv[0] << " --correlated-spikes <config.json> <output.csv>" << std::endl;
+        std::cerr << "       " << argv[0] << " --plan <config.json> [text|json]" << std::endl;
+        std::cerr << "       " << argv[0] << " --benchmark [kernel_costs.csv]" << std::endl;
+        std::cerr << "       " << argv[0] << " --autotune [autotune.csv]" << std::endl;
+        return 1;
+    }
+    std::string config_path = argv[1];
+    Config file_config(config_path);
+    load_tuning(file_config);
+
+    // One run per "regions" entry and "sweep" combination, or just the file itself
+    for (const Config& config : file_config.expand()) {
+        std::vector<std::string> outputs;
+        int status = run_cached(config, outputs);
+
+        // Frames are rendered from the trajectory file, so a cache hit renders too
+        const std::string mode = config.has("mode") ? config.get_string("mode") : "single";
+        const bool frames = flag_set(config, "render_frames");
+        const bool video = flag_set(config, "render_video");
+        if (status == 0 && mode == "single" && (frames || video)) {
+            status = render_outputs(config, "../data/synapse_data_" + config.get_string("region") + ".csv", frames, video);
+        }
+        if (status != 0) return status;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        return run_command(argc, argv);
+    } catch (const ConfigError& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,100 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+// --- ThreadPool Class Implementation ---
+
+ThreadPool::ThreadPool(size_t threads, AffinityPolicy affinity) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    const NumaTopology& topology = NumaTopology::detect();
+    cpus = topology.plan(affinity, threads);
+    for (int cpu : cpus) nodes.push_back(topology.node_of(cpu));
+    own_tasks.resize(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    task_ready.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    // Pinned before the first task, so the worker's stack and everything it
+    // allocates and touches lands on its own node
+    if (!cpus.empty()) pin_current_thread(cpus[index]);
+    std::deque<std::function<void(size_t)>>& own = own_tasks[index];
+    while (true) {
+        std::function<void(size_t)> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            task_ready.wait(lock, [this, &own] { return stopping || !own.empty() || !tasks.empty(); });
+            std::deque<std::function<void(size_t)>>& queue = own.empty() ? tasks : own;
+            if (queue.empty()) return;
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+        task(index);
+    }
+}
+
+void ThreadPool::parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t, size_t)>& fn) {
+    if (n == 0) return;
+    if (grain == 0) grain = 1;
+
+    std::mutex done_mutex;
+    std::condition_variable all_done;
+    size_t remaining = (n + grain - 1) / grain;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t begin = 0; begin < n; begin += grain) {
+            size_t end = begin + grain < n ? begin + grain : n;
+            tasks.push_back([&, begin, end](size_t worker) {
+                fn(begin, end, worker);
+                std::lock_guard<std::mutex> done_lock(done_mutex);
+                if (--remaining == 0) all_done.notify_one();
+            });
+        }
+    }
+    task_ready.notify_all();
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    all_done.wait(lock, [&remaining] { return remaining == 0; });
+}
+
+void ThreadPool::partition(size_t n, size_t worker, size_t& begin, size_t& end) const {
+    const size_t count = workers.size();
+    begin = n / count * worker + std::min(worker, n % count);
+    end = begin + n / count + (worker < n % count ? 1 : 0);
+}
+
+void ThreadPool::parallel_for_partitioned(size_t n, const std::function<void(size_t, size_t, size_t)>& fn) {
+    if (n == 0) return;
+
+    std::mutex done_mutex;
+    std::condition_variable all_done;
+    size_t remaining = workers.size();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t w = 0; w < workers.size(); ++w) {
+            own_tasks[w].push_back([&, n](size_t worker) {
+                size_t begin, end;
+                partition(n, worker, begin, end);
+                if (begin < end) fn(begin, end, worker);
+                std::lock_guard<std::mutex> done_lock(done_mutex);
+                if (--remaining == 0) all_done.notify_one();
+            });
+        }
+    }
+    task_ready.notify_all();
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    all_done.wait(lock, [&remaining] { return remaining == 0; });
+}
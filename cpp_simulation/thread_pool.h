@@ -0,0 +1,54 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "numa.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from a shared task queue.
+// Tasks receive the index of the worker running them, so callers can keep
+// per-worker scratch state without locking.
+class ThreadPool {
+public:
+    // threads == 0 uses one worker per hardware thread. With an affinity policy
+    // each worker pins itself to its CPU before taking any task.
+    explicit ThreadPool(size_t threads = 0, AffinityPolicy affinity = AffinityPolicy::None);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+    // NUMA node worker `worker` is pinned to, or -1 when workers are not pinned
+    int worker_node(size_t worker) const { return nodes.empty() ? -1 : nodes[worker]; }
+
+    // Splits [0, n) into chunks of `grain` items and runs fn(begin, end, worker)
+    // for each chunk on the workers. Blocks until every chunk has finished.
+    void parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t, size_t)>& fn);
+
+    // Splits [0, n) into one contiguous slice per worker and runs fn(begin, end, worker)
+    // on that worker. The same n always gives a worker the same slice, so arrays it
+    // first touched in an earlier call are still on its node.
+    void parallel_for_partitioned(size_t n, const std::function<void(size_t, size_t, size_t)>& fn);
+    // Slice [begin, end) of [0, n) that parallel_for_partitioned gives `worker`
+    void partition(size_t n, size_t worker, size_t& begin, size_t& end) const;
+
+private:
+    void worker_loop(size_t index);
+
+    std::vector<std::thread> workers;
+    std::vector<int> cpus;  // pinned CPU per worker, empty when not pinned
+    std::vector<int> nodes; // NUMA node per pinned worker
+    std::deque<std::function<void(size_t)>> tasks;
+    std::vector<std::deque<std::function<void(size_t)>>> own_tasks; // tasks only worker i may run
+    std::mutex mutex;
+    std::condition_variable task_ready;
+    bool stopping = false;
+};
+
+#endif // THREAD_POOL_H
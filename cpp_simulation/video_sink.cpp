@@ -0,0 +1,158 @@
+#include "video_sink.h"
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Single-quotes a path for the shell command line handed to popen
+std::string shell_quote(const std::string& text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+}
+
+void create_parent_directory(const std::string& path) {
+    fs::path parent = fs::path(path).parent_path();
+    if (parent.empty()) return;
+    std::error_code ec;
+    fs::create_directories(parent, ec);
+}
+
+} // namespace
+
+// --- FfmpegSink Class Implementation ---
+
+FfmpegSink::FfmpegSink(const std::string& output_path, int width, int height, double fps, const std::string& codec) {
+    create_parent_directory(output_path);
+    std::ostringstream command;
+    command << "ffmpeg -loglevel error -y -f rawvideo -pix_fmt rgb24 -s " << width << "x" << height
+            << " -r " << fps << " -i - -c:v " << shell_quote(codec) << " -pix_fmt yuv420p " << shell_quote(output_path);
+    // A failed ffmpeg must surface as a write error, not kill the simulator
+    std::signal(SIGPIPE, SIG_IGN);
+    pipe = popen(command.str().c_str(), "w");
+    if (!pipe) {
+        std::cerr << "Error: Could not start ffmpeg for " << output_path << std::endl;
+    }
+}
+
+FfmpegSink::~FfmpegSink() {
+    if (pipe) pclose(pipe);
+}
+
+bool FfmpegSink::available() {
+    return std::system("ffmpeg -version > /dev/null 2>&1") == 0;
+}
+
+bool FfmpegSink::write(size_t, const FrameBuffer& frame) {
+    if (!pipe || failed) return false;
+    if (std::fwrite(frame.rgb.data(), 1, frame.rgb.size(), pipe) != frame.rgb.size()) {
+        std::cerr << "Error: ffmpeg stopped accepting frames." << std::endl;
+        failed = true;
+    }
+    return !failed;
+}
+
+bool FfmpegSink::finish() {
+    if (!pipe) return false;
+    int status = pclose(pipe);
+    pipe = nullptr;
+    if (status != 0) {
+        std::cerr << "Error: ffmpeg exited with status " << status << std::endl;
+        return false;
+    }
+    return !failed;
+}
+
+// --- Y4mSink Class Implementation ---
+
+Y4mSink::Y4mSink(const std::string& output_path, int width, int height, double fps)
+    : outfile(nullptr, std::fclose) {
+    if (width % 2 != 0 || height % 2 != 0) {
+        std::cerr << "Error: 4:2:0 video needs even frame dimensions, got " << width << "x" << height << std::endl;
+        return;
+    }
+    create_parent_directory(output_path);
+    outfile.reset(std::fopen(output_path.c_str(), "wb"));
+    if (!outfile) {
+        std::cerr << "Error: Could not open output file " << output_path << std::endl;
+        return;
+    }
+    long long rate = std::llround(fps * 1000);
+    std::fprintf(outfile.get(), "YUV4MPEG2 W%d H%d F%lld:1000 Ip A1:1 C420jpeg\n", width, height, rate);
+    planes.resize(static_cast<size_t>(width) * height * 3 / 2);
+}
+
+bool Y4mSink::write(size_t, const FrameBuffer& frame) {
+    if (!outfile || failed) return false;
+    const int w = frame.width, h = frame.height;
+    const uint8_t* rgb = frame.rgb.data();
+    uint8_t* luma = planes.data();
+    uint8_t* cb = luma + static_cast<size_t>(w) * h;
+    uint8_t* cr = cb + static_cast<size_t>(w) * h / 4;
+
+    // BT.601 limited range, as ffmpeg converts rgb24 to yuv420p by default
+    for (size_t i = 0; i < static_cast<size_t>(w) * h; ++i) {
+        int r = rgb[3 * i], g = rgb[3 * i + 1], b = rgb[3 * i + 2];
+        luma[i] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+    for (int y = 0; y < h; y += 2) {
+        for (int x = 0; x < w; x += 2) {
+            int r = 0, g = 0, b = 0;
+            for (int dy = 0; dy < 2; ++dy) {
+                const uint8_t* p = rgb + (static_cast<size_t>(y + dy) * w + x) * 3;
+                r += p[0] + p[3];
+                g += p[1] + p[4];
+                b += p[2] + p[5];
+            }
+            r = (r + 2) / 4;
+            g = (g + 2) / 4;
+            b = (b + 2) / 4;
+            size_t c = static_cast<size_t>(y / 2) * (w / 2) + x / 2;
+            cb[c] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            cr[c] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    if (std::fputs("FRAME\n", outfile.get()) < 0 ||
+        std::fwrite(planes.data(), 1, planes.size(), outfile.get()) != planes.size()) {
+        std::cerr << "Error: Could not write video frame." << std::endl;
+        failed = true;
+    }
+    return !failed;
+}
+
+bool Y4mSink::finish() {
+    if (!outfile) return false;
+    bool closed = std::fclose(outfile.release()) == 0;
+    return closed && !failed;
+}
+
+// --- Video Sink Selection ---
+
+std::unique_ptr<FrameSink> open_video_sink(const std::string& output_path, int width, int height, double fps,
+                                           const std::string& encoder, const std::string& codec) {
+    if (encoder == "ffmpeg" || (encoder == "auto" && FfmpegSink::available())) {
+        std::unique_ptr<FfmpegSink> sink(new FfmpegSink(output_path, width, height, fps, codec));
+        if (!sink->is_open()) return nullptr;
+        std::cout << "Encoding with ffmpeg to " << output_path << std::endl;
+        return std::unique_ptr<FrameSink>(sink.release());
+    }
+    if (encoder != "auto" && encoder != "y4m") {
+        std::cerr << "Error: Unknown video_encoder '" << encoder << "' (expected auto, ffmpeg or y4m)." << std::endl;
+        return nullptr;
+    }
+    std::string y4m_path = fs::path(output_path).replace_extension(".y4m").string();
+    std::unique_ptr<Y4mSink> sink(new Y4mSink(y4m_path, width, height, fps));
+    if (!sink->is_open()) return nullptr;
+    std::cout << "Writing uncompressed YUV4MPEG2 video to " << y4m_path << std::endl;
+    return std::unique_ptr<FrameSink>(sink.release());
+}
@@ -0,0 +1,54 @@
+#ifndef VIDEO_SINK_H
+#define VIDEO_SINK_H
+
+#include "frame_renderer.h"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Streams raw RGB frames through a pipe into a locally spawned ffmpeg, which
+// encodes them straight to a video file; no intermediate images touch the disk.
+class FfmpegSink : public FrameSink {
+public:
+    FfmpegSink(const std::string& output_path, int width, int height, double fps, const std::string& codec);
+    ~FfmpegSink() override;
+
+    bool is_open() const { return pipe != nullptr; }
+    bool write(size_t index, const FrameBuffer& frame) override;
+    bool ordered() const override { return true; }
+    bool finish() override;
+
+    // True if an ffmpeg executable is on the PATH
+    static bool available();
+
+private:
+    FILE* pipe = nullptr;
+    bool failed = false;
+};
+
+// Fallback encoder with no dependencies: writes a YUV4MPEG2 (.y4m) stream of
+// 4:2:0 frames, which ffmpeg and most players read directly. Frame dimensions
+// must be even.
+class Y4mSink : public FrameSink {
+public:
+    Y4mSink(const std::string& output_path, int width, int height, double fps);
+
+    bool is_open() const { return outfile != nullptr; }
+    bool write(size_t index, const FrameBuffer& frame) override;
+    bool ordered() const override { return true; }
+    bool finish() override;
+
+private:
+    std::unique_ptr<FILE, int (*)(FILE*)> outfile;
+    std::vector<uint8_t> planes;
+    bool failed = false;
+};
+
+// Opens a video sink for `output_path` with `encoder` "ffmpeg", "y4m" or "auto"
+// (ffmpeg when available, otherwise y4m next to the requested path).
+// Returns nullptr, after reporting why, if no sink could be opened.
+std::unique_ptr<FrameSink> open_video_sink(const std::string& output_path, int width, int height, double fps,
+                                           const std::string& encoder, const std::string& codec = "libx264");
+
+#endif // VIDEO_SINK_H
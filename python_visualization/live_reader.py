@@ -0,0 +1,124 @@
+import mmap
+import os
+import struct
+import sys
+import time
+
+# Layout of the shared-memory segment written by cpp_simulation/live_stream.cpp
+SHM_DIR = '/dev/shm'
+MAGIC = b'QDLIVE1\x00'
+HEADER = struct.Struct('=8sIIQQII24s')  # magic, version, slot_size, capacity, published, finished, reserved, region
+SLOT = struct.Struct('=Qdddd')           # seq, time, pre_activity, post_activity, synaptic_weight
+PUBLISHED_OFFSET = 24
+FINISHED_OFFSET = 32
+SLOTS_OFFSET = 64
+
+
+class LiveStreamReader:
+    """Follows a live stream published by the C++ simulation (config key "live_stream").
+
+    Readers only ever read the segment, so any number of them can follow one run.
+    Each slot is a seqlock: a record is accepted only if its sequence number reads
+    the same, and matches the expected record, before and after the payload is copied.
+    """
+
+    def __init__(self, name):
+        self.path = os.path.join(SHM_DIR, name.lstrip('/'))
+        with open(self.path, 'rb') as f:
+            self.buffer = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version, slot_size, capacity, _, _, _, region = HEADER.unpack_from(self.buffer, 0)
+        if magic != MAGIC or version != 1 or slot_size != SLOT.size:
+            self.buffer.close()
+            raise ValueError(f"{self.path} is not a live stream segment")
+        self.capacity = capacity
+        self.region = region.rstrip(b'\x00').decode()
+        self.next_record = 0
+        self.lost = 0  # records overwritten before this reader got to them
+
+    def published(self):
+        return struct.unpack_from('=Q', self.buffer, PUBLISHED_OFFSET)[0]
+
+    def finished(self):
+        return struct.unpack_from('=I', self.buffer, FINISHED_OFFSET)[0] == 1
+
+    def poll(self):
+        """Returns the (time, pre, post, weight) records published since the last call."""
+        published = self.published()
+        if published - self.next_record > self.capacity:
+            self.lost += published - self.capacity - self.next_record
+            self.next_record = published - self.capacity
+
+        records = []
+        while self.next_record < published:
+            n = self.next_record
+            offset = SLOTS_OFFSET + (n % self.capacity) * SLOT.size
+            expected = 2 * n + 2
+            seq, t, pre, post, weight = SLOT.unpack_from(self.buffer, offset)
+            if seq == expected and struct.unpack_from('=Q', self.buffer, offset)[0] == expected:
+                records.append((t, pre, post, weight))
+            else:
+                self.lost += 1  # the producer lapped us while copying
+            self.next_record += 1
+        return records
+
+    def follow(self, interval=0.05):
+        """Yields batches of new records until the run finishes and the ring is drained."""
+        while True:
+            done = self.finished()
+            records = self.poll()
+            if records:
+                yield records
+            elif done:
+                return
+            else:
+                time.sleep(interval)
+
+    def close(self):
+        self.buffer.close()
+
+    def unlink(self):
+        """Removes the segment once no further reader needs it."""
+        os.remove(self.path)
+
+
+def main():
+    """Plots the synaptic weight of a running simulation as it is published."""
+    import matplotlib.pyplot as plt  # only the plotting front end needs matplotlib
+
+    if len(sys.argv) < 2:
+        print("Usage: python3 live_reader.py <live_stream name, e.g. /qd_live_cortex>")
+        return
+
+    try:
+        reader = LiveStreamReader(sys.argv[1])
+    except (OSError, ValueError) as error:
+        print(f"Error: {error}")
+        return
+
+    plt.ion()
+    fig, ax = plt.subplots(figsize=(10, 5))
+    fig.suptitle(f'Live Synaptic Weight - Region: {reader.region.title()}', fontsize=16)
+    line, = ax.plot([], [], 'b-', label='Synaptic Weight')
+    ax.set_ylim(0, 1.1)
+    ax.set_xlabel('Time (s)')
+    ax.set_ylabel('Weight')
+    ax.grid(True)
+    ax.legend(loc='upper left')
+
+    times, weights = [], []
+    for records in reader.follow():
+        for t, _, _, weight in records:
+            times.append(t)
+            weights.append(weight)
+        line.set_data(times, weights)
+        ax.set_xlim(0, max(times[-1], 1e-9))
+        plt.pause(0.001)
+
+    print(f"Run finished: {len(times)} samples received, {reader.lost} overwritten before they were read.")
+    reader.close()
+    plt.ioff()
+    plt.show()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,109 @@
+import math
+import mmap
+import struct
+import sys
+
+# Layout of the pyramid file written by cpp_simulation/lod_pyramid.cpp
+MAGIC = b'QDLOD1\x00\x00'
+HEADER = struct.Struct('=8sIIIIQdd16s')  # magic, version, channels, levels, first_level, samples, time_start, time_step, region
+LEVEL = struct.Struct('=QQ')             # offset, count
+CHANNELS = ('synaptic_weight', 'pre_activity', 'post_activity')
+
+
+class LodPyramid:
+    """Zoomable view of a trajectory through its min/max/mean pyramid (config key "lod_pyramid").
+
+    Level L holds one bucket per 2**L samples, so any time window is answered from
+    the coarsest level that still gives about `pixels` buckets: the cost of a query
+    depends on the screen width, not on the length of the run. Levels start at
+    `first_level` (3 for files written now); a window narrower than that returns
+    fewer buckets than pixels, and the raw trace has the individual samples.
+    """
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.buffer = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        (magic, version, channels, levels, first_level, samples,
+         self.time_start, self.time_step, region) = HEADER.unpack_from(self.buffer, 0)
+        if magic != MAGIC or version not in (1, 2) or channels != len(CHANNELS):
+            self.buffer.close()
+            raise ValueError(f"{path} is not a level-of-detail pyramid")
+        # Version 1 files stored every level, starting from the raw samples
+        self.first_level = first_level if version >= 2 else 0
+        self.samples = samples
+        self.region = region.rstrip(b'\x00').decode()
+        self.bucket = struct.Struct('=' + 'f' * (3 * channels))  # mins, maxes, means
+        self.levels = [LEVEL.unpack_from(self.buffer, HEADER.size + i * LEVEL.size) for i in range(levels)]
+
+    def choose_level(self, first, last, pixels):
+        """Coarsest stored level with at least `pixels` buckets over samples [first, last)."""
+        span = max(last - first, 1)
+        level = int(math.floor(math.log2(span / pixels))) if span > pixels else 0
+        return min(max(level, self.first_level), self.first_level + len(self.levels) - 1)
+
+    def query(self, t_begin, t_end, pixels=2000, channel='synaptic_weight'):
+        """Returns (times, mins, maxes, means) for the window [t_begin, t_end].
+
+        Each entry summarizes one bucket; `times` are bucket start times.
+        """
+        if not self.levels:
+            return [], [], [], []
+        c = CHANNELS.index(channel)
+        step = self.time_step if self.time_step > 0 else 1.0
+        first = max(0, int(math.floor((t_begin - self.time_start) / step)))
+        last = min(self.samples, int(math.ceil((t_end - self.time_start) / step)) + 1)
+        if last <= first:
+            return [], [], [], []
+
+        level = self.choose_level(first, last, pixels)
+        offset, count = self.levels[level - self.first_level]
+        j_first = first >> level
+        j_last = min(count, ((last - 1) >> level) + 1)
+
+        times, mins, maxes, means = [], [], [], []
+        for j in range(j_first, j_last):
+            values = self.bucket.unpack_from(self.buffer, offset + j * self.bucket.size)
+            times.append(self.time_start + (j << level) * self.time_step)
+            mins.append(values[c])
+            maxes.append(values[len(CHANNELS) + c])
+            means.append(values[2 * len(CHANNELS) + c])
+        return times, mins, maxes, means
+
+    def close(self):
+        self.buffer.close()
+
+
+def main():
+    """Plots the min/max envelope and mean of the weight over a time window."""
+    if len(sys.argv) < 2:
+        print("Usage: python3 lod_reader.py <synapse_lod_<region>.bin> [t_begin t_end]")
+        return
+
+    import matplotlib.pyplot as plt  # only the plotting front end needs matplotlib
+
+    try:
+        pyramid = LodPyramid(sys.argv[1])
+    except (OSError, ValueError) as error:
+        print(f"Error: {error}")
+        return
+
+    t_end_default = pyramid.time_start + pyramid.time_step * max(pyramid.samples - 1, 0)
+    t_begin = float(sys.argv[2]) if len(sys.argv) > 3 else pyramid.time_start
+    t_end = float(sys.argv[3]) if len(sys.argv) > 3 else t_end_default
+    times, mins, maxes, means = pyramid.query(t_begin, t_end)
+
+    fig, ax = plt.subplots(figsize=(10, 5))
+    fig.suptitle(f'Synaptic Weight - Region: {pyramid.region.title()}', fontsize=16)
+    ax.fill_between(times, mins, maxes, color='b', alpha=0.3, step='post', label='Min/Max')
+    ax.plot(times, means, 'b-', label='Mean')
+    ax.set_ylim(0, 1.1)
+    ax.set_xlabel('Time (s)')
+    ax.set_ylabel('Weight')
+    ax.grid(True)
+    ax.legend(loc='upper left')
+    plt.show()
+    pyramid.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,85 @@
+import unittest
+import os
+import sys
+import shutil
+import struct
+import tempfile
+from unittest.mock import patch
+
+# Add the script's directory to the Python path to allow importing
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..', 'python_visualization')))
+
+import live_reader
+
+
+def write_segment(path, capacity, records, finished=False, region=b'cortex'):
+    """Writes a segment as the C++ producer would after publishing `records`."""
+    data = bytearray(live_reader.SLOTS_OFFSET + capacity * live_reader.SLOT.size)
+    live_reader.HEADER.pack_into(data, 0, live_reader.MAGIC, 1, live_reader.SLOT.size, capacity,
+                                 len(records), 1 if finished else 0, 0, region)
+    for n, record in enumerate(records):
+        offset = live_reader.SLOTS_OFFSET + (n % capacity) * live_reader.SLOT.size
+        live_reader.SLOT.pack_into(data, offset, 2 * n + 2, *record)
+    with open(path, 'wb') as f:
+        f.write(data)
+
+
+class TestLiveReader(unittest.TestCase):
+
+    def setUp(self):
+        """Redirect the shared-memory directory to a scratch directory."""
+        self.shm_dir = tempfile.mkdtemp()
+        self.shm_patch = patch('live_reader.SHM_DIR', self.shm_dir)
+        self.shm_patch.start()
+        self.path = os.path.join(self.shm_dir, 'qd_test')
+
+    def tearDown(self):
+        self.shm_patch.stop()
+        shutil.rmtree(self.shm_dir)
+
+    def test_poll_returns_new_records_in_order(self):
+        records = [(0.0, 1.0, 0.0, 0.5), (0.1, 0.0, 1.0, 0.51), (0.2, 1.0, 1.0, 0.55)]
+        write_segment(self.path, 8, records)
+        reader = live_reader.LiveStreamReader('/qd_test')
+        self.assertEqual(reader.region, 'cortex')
+        self.assertEqual(reader.poll(), records)
+        self.assertEqual(reader.poll(), [])
+        reader.close()
+
+    def test_overrun_skips_to_oldest_available_record(self):
+        """Given a reader that fell behind, when polling, then only records still in the ring are returned."""
+        records = [(0.1 * n, 0.0, 0.0, 0.01 * n) for n in range(10)]
+        write_segment(self.path, 4, records)
+        reader = live_reader.LiveStreamReader('/qd_test')
+        self.assertEqual(reader.poll(), records[6:])
+        self.assertEqual(reader.lost, 6)
+        reader.close()
+
+    def test_slot_being_rewritten_is_skipped(self):
+        records = [(0.0, 0.0, 0.0, 0.5), (0.1, 0.0, 0.0, 0.6)]
+        write_segment(self.path, 4, records)
+        # Mark record 1 as mid-write (odd sequence number)
+        with open(self.path, 'r+b') as f:
+            f.seek(live_reader.SLOTS_OFFSET + live_reader.SLOT.size)
+            f.write(struct.pack('=Q', 3))
+        reader = live_reader.LiveStreamReader('/qd_test')
+        self.assertEqual(reader.poll(), records[:1])
+        self.assertEqual(reader.lost, 1)
+        reader.close()
+
+    def test_follow_stops_after_finished_stream_is_drained(self):
+        records = [(0.0, 1.0, 1.0, 0.5), (0.1, 0.0, 0.0, 0.49)]
+        write_segment(self.path, 4, records, finished=True)
+        reader = live_reader.LiveStreamReader('/qd_test')
+        self.assertEqual(list(reader.follow(interval=0)), [records])
+        reader.close()
+
+    def test_rejects_foreign_segment(self):
+        with open(self.path, 'wb') as f:
+            f.write(b'\x00' * 128)
+        with self.assertRaises(ValueError):
+            live_reader.LiveStreamReader('/qd_test')
+
+
+if __name__ == '__main__':
+    unittest.main()
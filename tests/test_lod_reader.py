@@ -0,0 +1,106 @@
+import unittest
+import os
+import sys
+import shutil
+import struct
+import tempfile
+
+# Add the script's directory to the Python path to allow importing
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..', 'python_visualization')))
+
+import lod_reader
+
+
+def write_pyramid(path, weights, time_start=0.0, time_step=0.5, region=b'cortex', first_level=3, version=2):
+    """Writes a pyramid as cpp_simulation/lod_pyramid.cpp would (activity channels zero)."""
+    levels = [[(w, w, w) for w in weights]]
+    spans = [[1] * len(weights)]
+    while len(levels[-1]) > 1:
+        below, below_spans = levels[-1], spans[-1]
+        level, level_spans = [], []
+        for i in range(0, len(below), 2):
+            group = below[i:i + 2]
+            counts = below_spans[i:i + 2]
+            total = sum(counts)
+            mean = sum(b[2] * c for b, c in zip(group, counts)) / total
+            level.append((min(b[0] for b in group), max(b[1] for b in group), mean))
+            level_spans.append(total)
+        levels.append(level)
+        spans.append(level_spans)
+    levels = levels[first_level:]
+
+    data = bytearray(lod_reader.HEADER.pack(lod_reader.MAGIC, version, 3, len(levels), first_level, len(weights),
+                                            time_start, time_step, region))
+    offset = lod_reader.HEADER.size + len(levels) * lod_reader.LEVEL.size
+    bucket = struct.Struct('=9f')
+    for level in levels:
+        data += lod_reader.LEVEL.pack(offset, len(level))
+        offset += len(level) * bucket.size
+    for level in levels:
+        for lo, hi, mean in level:
+            data += bucket.pack(lo, 0, 0, hi, 0, 0, mean, 0, 0)
+    with open(path, 'wb') as f:
+        f.write(data)
+
+
+class TestLodReader(unittest.TestCase):
+
+    def setUp(self):
+        self.test_dir = tempfile.mkdtemp()
+        self.path = os.path.join(self.test_dir, 'synapse_lod_cortex.bin')
+        self.weights = [((i * 37) % 101) / 100.0 for i in range(1000)]
+        write_pyramid(self.path, self.weights)
+
+    def tearDown(self):
+        shutil.rmtree(self.test_dir)
+
+    def test_header_and_levels(self):
+        pyramid = lod_reader.LodPyramid(self.path)
+        self.assertEqual(pyramid.samples, 1000)
+        self.assertEqual(pyramid.region, 'cortex')
+        self.assertEqual(pyramid.first_level, 3)
+        self.assertEqual([count for _, count in pyramid.levels][:3], [125, 63, 32])
+        self.assertEqual(pyramid.levels[-1][1], 1)
+        pyramid.close()
+
+    def test_full_zoom_uses_finest_stored_level(self):
+        """Given a window narrower than the pixels, when querying, then buckets of 8 samples come back."""
+        pyramid = lod_reader.LodPyramid(self.path)
+        times, mins, maxes, means = pyramid.query(10.0, 14.0, pixels=100)
+        self.assertEqual(times, [8.0, 12.0])
+        for j, (lo, hi, mean) in enumerate(zip(mins, maxes, means)):
+            bucket = self.weights[16 + 8 * j:24 + 8 * j]
+            self.assertAlmostEqual(lo, min(bucket), places=6)
+            self.assertAlmostEqual(hi, max(bucket), places=6)
+            self.assertAlmostEqual(mean, sum(bucket) / len(bucket), places=6)
+        pyramid.close()
+
+    def test_version_1_file_keeps_raw_level(self):
+        write_pyramid(self.path, self.weights, first_level=0, version=1)
+        pyramid = lod_reader.LodPyramid(self.path)
+        self.assertEqual(pyramid.first_level, 0)
+        times, mins, maxes, means = pyramid.query(10.0, 14.0, pixels=100)
+        self.assertEqual(times, [10.0 + 0.5 * i for i in range(9)])
+        for got, expected in zip(means, self.weights[20:29]):
+            self.assertAlmostEqual(got, expected, places=6)
+        pyramid.close()
+
+    def test_wide_window_is_bounded_by_pixels_and_keeps_extremes(self):
+        """Given the whole run, when querying 50 pixels, then buckets stay near 50 and keep the min/max envelope."""
+        pyramid = lod_reader.LodPyramid(self.path)
+        times, mins, maxes, means = pyramid.query(0.0, 499.5, pixels=50)
+        self.assertGreaterEqual(len(times), 50)
+        self.assertLess(len(times), 100)
+        self.assertAlmostEqual(min(mins), min(self.weights), places=6)
+        self.assertAlmostEqual(max(maxes), max(self.weights), places=6)
+        pyramid.close()
+
+    def test_rejects_foreign_file(self):
+        with open(self.path, 'wb') as f:
+            f.write(b'\x00' * 128)
+        with self.assertRaises(ValueError):
+            lod_reader.LodPyramid(self.path)
+
+
+if __name__ == '__main__':
+    unittest.main()